@@ -0,0 +1,223 @@
+/*
+Микробенчмарки горячих функций движка: find_turns, make_turn, calc_score, пакетная оценка calc_scores
+(время на одну позицию) и find_best_turns на фиксированной глубине для набора позиций.
+Результаты выводятся в JSON (stdout или файл из --out), чтобы сравнивать
+производительность движка между коммитами.
+
+Сборка (Linux):
+    g++ -O2 -std=c++17 $(sdl2-config --cflags) Benchmarks/bench.cpp -o bench
+Запуск из корня проекта (нужен settings.json):
+    ./bench [--out bench.json] [--min-time-ms 300] [--filter find_turns] [--positions Benchmarks/positions.fen]
+--positions добавляет замер find_best_turns по всему набору позиций из файла FEN.
+*/
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../Game/Logic.h"
+#include "../Models/Fen.h"
+
+using namespace std;
+
+namespace
+{
+// Позиция для бенчмарка: имя класса позиции и FEN (см. Models/Fen.h)
+struct Bench_position
+{
+    string name;
+    string fen;
+};
+
+const vector<Bench_position> positions = {
+    {"opening", "W:W21-32:B1-12"},
+    {"midgame", "W:W17,22,23,25,27,28,29,30,32:B1,2,3,4,5,7,8,10,12,14,19"},
+    {"king_endgame", "W:WK17,K26,32:BK2,11"},
+    {"multi_capture", "W:W25,K32:B4,6,7,14,15,22,23,24"},
+};
+
+fen_position parse(const string &fen)
+{
+    fen_position pos;
+    if (!parse_fen(fen, pos))
+        throw runtime_error("bad FEN in benchmark set: " + fen);
+    return pos;
+}
+
+// Не даёт компилятору выбросить результат вычислений
+volatile double sink;
+
+struct Bench_result
+{
+    string name;
+    uint64_t iterations;
+    double ns_per_iter;
+    uint64_t nodes;
+};
+
+// Запускает body, пока суммарное время не превысит min_time, и возвращает среднее время итерации
+Bench_result run(const string &name, const function<void()> &body, const chrono::milliseconds min_time)
+{
+    // прогрев
+    body();
+    uint64_t iterations = 0;
+    auto start = chrono::steady_clock::now();
+    auto elapsed = chrono::steady_clock::duration::zero();
+    // число итераций удваивается, чтобы время замера не влияло на результат
+    for (uint64_t batch = 1; elapsed < min_time; batch *= 2)
+    {
+        for (uint64_t k = 0; k < batch; ++k)
+            body();
+        iterations += batch;
+        elapsed = chrono::steady_clock::now() - start;
+    }
+    return {name, iterations, chrono::duration<double, nano>(elapsed).count() / iterations, 0};
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    string out_path, filter, positions_path;
+    chrono::milliseconds min_time(300);
+    for (int k = 1; k < argc; ++k)
+    {
+        if (!strcmp(argv[k], "--out") && k + 1 < argc)
+            out_path = argv[++k];
+        else if (!strcmp(argv[k], "--filter") && k + 1 < argc)
+            filter = argv[++k];
+        else if (!strcmp(argv[k], "--positions") && k + 1 < argc)
+            positions_path = argv[++k];
+        else if (!strcmp(argv[k], "--min-time-ms") && k + 1 < argc)
+            min_time = chrono::milliseconds(stoi(argv[++k]));
+        else
+        {
+            cerr << "usage: bench [--out file.json] [--filter substring] [--min-time-ms N] [--positions file.fen]\n";
+            return 1;
+        }
+    }
+
+    // Детерминированный бот, чтобы прогоны были сравнимы
+    Config config;
+    config.set("Bot", "NoRandom", true);
+    Logic logic(nullptr, &config);
+
+    vector<Bench_result> results;
+    // items - число одинаковых действий за вызов body, время выводится на одно действие
+    auto bench = [&](const string &name, const function<void()> &body, const size_t items = 1) {
+        if (name.find(filter) == string::npos)
+            return;
+        results.push_back(run(name, body, min_time));
+        results.back().ns_per_iter /= items;
+        cerr << name << ": " << results.back().ns_per_iter << " ns\n";
+    };
+
+    for (const auto &bench_pos : positions)
+    {
+        const auto pos = parse(bench_pos.fen);
+        const auto mtx = to_mtx(pos);
+        bench("find_turns/" + bench_pos.name, [&] {
+            logic.find_turns(pos.color, mtx);
+            sink = logic.turns.size();
+        });
+        bench("calc_score/" + bench_pos.name, [&] { sink = logic.calc_score(mtx, pos.color); });
+        logic.find_turns(pos.color, mtx);
+        const auto turns = logic.turns;
+        bench("make_turn/" + bench_pos.name, [&] {
+            for (const auto &turn : turns)
+                sink = logic.make_turn(mtx, turn)[turn.x2][turn.y2];
+        });
+    }
+
+    // Пакетная оценка: все позиции набора, повторённые до 4096, время на одну позицию
+    {
+        Position_batch batch;
+        for (size_t k = 0; k < 4096; ++k)
+        {
+            const auto pos = parse(positions[k % positions.size()].fen);
+            batch.add(pos, pos.color);
+        }
+        vector<int> scores;
+        bench(
+            "calc_scores/batch",
+            [&] {
+                logic.calc_scores(batch, scores);
+                sink = scores.back();
+            },
+            batch.size());
+    }
+
+    for (const int depth : {1, 3, 5})
+    {
+        for (const auto &bench_pos : positions)
+        {
+            const auto pos = parse(bench_pos.fen);
+            const auto mtx = to_mtx(pos);
+            const string name = "find_best_turns/" + bench_pos.name + "/depth:" + to_string(depth);
+            logic.Max_depth = depth;
+            bench(name, [&] { sink = logic.find_best_turns(mtx, pos.color).size(); });
+#ifndef NO_STATS
+            if (!results.empty() && results.back().name == name)
+                results.back().nodes = logic.stats.total_nodes();
+#endif
+        }
+    }
+
+    // Набор позиций из файла: суммарное время поиска по всем позициям
+    if (!positions_path.empty())
+    {
+        vector<vector<vector<POS_T>>> corpus;
+        vector<bool> colors;
+        for (const auto &pos : load_fen_file(positions_path))
+        {
+            corpus.push_back(to_mtx(pos));
+            colors.push_back(pos.color);
+        }
+        for (const int depth : {1, 3})
+        {
+            const string name = "find_best_turns/corpus/depth:" + to_string(depth);
+            logic.Max_depth = depth;
+            uint64_t nodes = 0;
+            bench(name, [&] {
+                nodes = 0;
+                for (size_t k = 0; k < corpus.size(); ++k)
+                {
+                    sink = logic.find_best_turns(corpus[k], colors[k]).size();
+                    STATS(nodes += logic.stats.total_nodes());
+                }
+            });
+            if (!results.empty() && results.back().name == name)
+                results.back().nodes = nodes;
+        }
+    }
+
+    json report;
+    report["context"] = {{"compiler", __VERSION__},
+                         {"min_time_ms", min_time.count()},
+#ifdef NO_STATS
+                         {"stats", false}};
+#else
+                         {"stats", true}};
+#endif
+    report["benchmarks"] = json::array();
+    for (const auto &res : results)
+    {
+        json item = {{"name", res.name}, {"iterations", res.iterations}, {"ns_per_iter", res.ns_per_iter}};
+        if (res.nodes)
+            item["nodes"] = res.nodes;
+        report["benchmarks"].push_back(item);
+    }
+
+    if (out_path.empty())
+    {
+        cout << report.dump(2) << endl;
+    }
+    else
+    {
+        ofstream fout(out_path);
+        fout << report.dump(2) << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,524 @@
+/*
+Консольный движок шашек с текстовым протоколом в стиле UCI для внешних GUI и менеджеров матчей.
+Команды читаются из stdin, ответы пишутся в stdout:
+    uci                                  -> id name ..., option ..., uciok
+    isready                              -> readyok
+    setoption name <Name> value <Value>  - переопределяет настройку из раздела Bot в settings.json
+                                           (MultiPV - число линий анализа, TraceFile и TraceDepth - запись
+                                           дерева поиска, Hash и HashName - таблица перестановок,
+                                           настройки самого движка)
+    ucinewgame                           - начало новой партии
+    position startpos|fen <FEN> [moves <m1> <m2> ...]
+    go [depth N] [movetime MS] [nodes N] [wtime MS btime MS winc MS binc MS] [infinite] [ponder]
+    stop                                 - прерывает поиск, движок сразу отвечает bestmove
+    ponderhit                            - переводит поиск из ponder в обычный режим с контролем времени
+    quit
+Ходы записываются номерами полей (см. Models/Fen.h): "11-15" - обычный ход, "18x27x20" - серия взятий.
+Во время поиска после каждой досчитанной глубины выводится
+    info depth D score cp S|win N|loss N nodes N time MS pv <ход> <ответ> ...
+При MultiPV > 1 на каждой глубине печатается строка на каждую из лучших линий:
+    info depth D multipv K score ... pv <ход>
+Оценка S - в сотых долях шашки с точки зрения ходящей стороны, win/loss N - выигрыш или проигрыш через N ходов.
+Hash - размер таблицы перестановок в МБ (0 - без таблицы). Если задан HashName ("/checkers_tt"),
+таблица - именованный сегмент общей памяти: все движки машины с тем же HashName и той же оценкой
+(BotScoringType, параметры, сеть) ищут с одной таблицей, размер сегмента задаёт первый из них.
+Движок с другой оценкой к сегменту не подключается и ищет со своей таблицей.
+Если задан TraceFile, каждый go перезаписывает этот файл деревом своего поиска до TraceDepth полуходов
+от корня (Models/Search_trace.h), разбор - Tools/trace_analyze.cpp.
+
+Сборка (Linux):
+    g++ -O2 -std=c++17 -pthread $(sdl2-config --cflags) Engine/engine.cpp -o checkers_engine
+Запускать из корня проекта (нужен settings.json).
+*/
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Game/Logic.h"
+#include "../Models/Fen.h"
+#include "../Models/Search_trace.h"
+#include "../Models/Transposition_table.h"
+
+using namespace std;
+
+namespace
+{
+const char *start_fen = "W:W21-32:B1-12";
+// Глубина по умолчанию, если в go нет ограничений
+const int default_depth = 7;
+// Ограничение глубины для infinite и поиска по времени
+const int max_search_depth = 40;
+// Наибольшее число линий MultiPV
+const int max_multi_pv = 32;
+// Глубина записи дерева поиска по умолчанию и наибольшая
+const int default_trace_depth = 4;
+const int max_trace_depth = 32;
+// Размер таблицы перестановок по умолчанию, МБ
+const int default_hash_mb = 16;
+
+mutex out_mutex;
+
+void send(const string &line)
+{
+    lock_guard<mutex> lock(out_mutex);
+    cout << line << endl;
+}
+
+// Разбирает ход "11-15" или "18x27x20" и применяет его. Промежуточные поля серии взятий
+// можно опустить ("18x20"), если ход однозначен. Возвращает false для невозможного хода
+bool apply_move(Logic &logic, vector<vector<POS_T>> &mtx, bool &color, const string &text)
+{
+    vector<int> squares;
+    int value = 0;
+    bool have_digit = false;
+    for (const char c : text)
+    {
+        if (c >= '0' && c <= '9')
+        {
+            value = value * 10 + (c - '0');
+            have_digit = true;
+        }
+        else if ((c == '-' || c == 'x' || c == ':') && have_digit)
+        {
+            squares.push_back(value);
+            value = 0;
+            have_digit = false;
+        }
+        else
+            return false;
+    }
+    if (!have_digit)
+        return false;
+    squares.push_back(value);
+    if (squares.size() < 2)
+        return false;
+
+    const vector<move_pos> *found = nullptr;
+    const auto moves = logic.find_full_turns(mtx, color);
+    for (const auto &move : moves)
+    {
+        vector<int> path{cell_to_square(move[0].x, move[0].y)};
+        for (const auto &turn : move)
+            path.push_back(cell_to_square(turn.x2, turn.y2));
+        const bool full = (path == squares);
+        const bool short_form = (squares.size() == 2 && path.front() == squares[0] && path.back() == squares[1]);
+        if (!full && !short_form)
+            continue;
+        // Сокращённая запись должна указывать на единственный ход
+        if (found && !full)
+            return false;
+        found = &move;
+        if (full)
+            break;
+    }
+    if (!found)
+        return false;
+    for (const auto &turn : *found)
+        mtx = logic.make_turn(mtx, turn);
+    color = !color;
+    return true;
+}
+
+class Engine
+{
+  public:
+    Engine() : logic(nullptr, &config), tt(default_hash_mb)
+    {
+        logic.limits.stop = &stop;
+        logic.tt = &tt;
+        set_position(start_fen, {});
+    }
+
+    ~Engine()
+    {
+        stop_search();
+    }
+
+    // Главный цикл: читает команды, пока не придёт quit или не закончится ввод
+    void loop()
+    {
+        string line;
+        while (getline(cin, line))
+        {
+            istringstream in(line);
+            string cmd;
+            in >> cmd;
+            if (cmd == "uci")
+            {
+                send("id name Checkers");
+                send("id author fungusAcademy");
+                send("option name BotScoringType type combo default NumberAndPotential var NumberAndPotential var "
+                     "NumberOnly var Network");
+                send("option name NetworkFile type string default eval.nnue");
+                send("option name NoRandom type check default false");
+                send("option name Optimization type combo default O1 var O0 var O1 var O2");
+                send("option name MultiPV type spin default 1 min 1 max " + to_string(max_multi_pv));
+                send("option name TraceFile type string default <empty>");
+                send("option name TraceDepth type spin default " + to_string(default_trace_depth) + " min 1 max " +
+                     to_string(max_trace_depth));
+                send("option name Hash type spin default " + to_string(default_hash_mb) + " min 0 max " +
+                     to_string(Transposition_table::MAX_MB));
+                send("option name HashName type string default <empty>");
+                send("uciok");
+            }
+            else if (cmd == "isready")
+                send("readyok");
+            else if (cmd == "setoption")
+                set_option(in);
+            else if (cmd == "ucinewgame")
+            {
+                stop_search();
+                logic.new_game();
+                // общую таблицу используют другие движки, её не очищаем
+                if (!tt.is_shared())
+                    tt.clear();
+                set_position(start_fen, {});
+            }
+            else if (cmd == "position")
+                position(in);
+            else if (cmd == "go")
+                go(in);
+            else if (cmd == "stop")
+                stop_search();
+            else if (cmd == "ponderhit")
+                ponderhit();
+            else if (cmd == "quit")
+                break;
+            else if (!cmd.empty())
+                send("info string unknown command " + cmd);
+        }
+    }
+
+  private:
+    void set_option(istringstream &in)
+    {
+        // setoption name <Name> value <Value>
+        string token, name, value;
+        in >> token >> name >> token;
+        getline(in >> ws, value);
+        if (name == "MultiPV")
+        {
+            stop_search();
+            multi_pv = max(1, min(atoi(value.c_str()), max_multi_pv));
+            return;
+        }
+        if (name == "TraceFile")
+        {
+            stop_search();
+            trace_file = (value == "<empty>" ? "" : value);
+            return;
+        }
+        if (name == "TraceDepth")
+        {
+            stop_search();
+            trace_depth = max(1, min(atoi(value.c_str()), max_trace_depth));
+            return;
+        }
+        if (name == "Hash" || name == "HashName")
+        {
+            stop_search();
+            if (name == "Hash")
+                hash_mb = max(0, min(atoi(value.c_str()), int(Transposition_table::MAX_MB)));
+            else
+                hash_name = (value == "<empty>" ? "" : value);
+            open_hash();
+            return;
+        }
+        if (name != "BotScoringType" && name != "NoRandom" && name != "Optimization" && name != "NetworkFile")
+        {
+            send("info string unknown option " + name);
+            return;
+        }
+        stop_search();
+        if (name == "NoRandom")
+            config.set("Bot", name, value == "true");
+        else
+            config.set("Bot", name, value);
+        // Позиция, история партии и загруженная сеть остаются, меняются только настройки оценки
+        const auto settings = config.settings();
+        const uint64_t old_eval = logic.eval_fingerprint;
+        logic.configure(*settings);
+        if (name == "NoRandom")
+            logic.seed_random(settings->no_random);
+        // Оценки в таблице посчитаны прежней оценкой: своя таблица очищается, общая подключается заново
+        // (сегмент с другой оценкой не подойдёт, и таблица станет своей)
+        if (logic.eval_fingerprint != old_eval && hash_mb)
+        {
+            if (tt.is_shared())
+                open_hash();
+            else
+                tt.clear();
+        }
+    }
+
+    // Создаёт таблицу перестановок по Hash и HashName
+    void open_hash()
+    {
+        logic.tt = nullptr;
+        if (!hash_mb)
+        {
+            tt.resize(0);
+            return;
+        }
+        if (hash_name.empty())
+            tt.resize(size_t(hash_mb));
+        else if (tt.open_shared(hash_name, size_t(hash_mb), Russian_rules::SIZE, logic.eval_fingerprint))
+            send("info string shared hash " + hash_name + " " + to_string(tt.size_mb()) + " MB");
+        else
+            send("info string cannot open shared hash " + hash_name + ", using private " + to_string(hash_mb) + " MB");
+        logic.tt = &tt;
+    }
+
+    bool set_position(const string &fen, const vector<string> &moves)
+    {
+        fen_position pos;
+        if (!parse_fen(fen, pos))
+        {
+            send("info string bad fen " + fen);
+            return false;
+        }
+        mtx = to_mtx(pos);
+        color = pos.color;
+        // Позиции после ходов попадают в историю: поиск распознаёт повторения
+        logic.history.clear();
+        logic.history.push(mtx, color);
+        for (const auto &move : moves)
+        {
+            if (!apply_move(logic, mtx, color, move))
+            {
+                send("info string illegal move " + move);
+                return false;
+            }
+            logic.history.push(mtx, color);
+        }
+        return true;
+    }
+
+    void position(istringstream &in)
+    {
+        stop_search();
+        string token, fen;
+        in >> token;
+        if (token == "startpos")
+            fen = start_fen;
+        else if (token == "fen")
+        {
+            // FEN может содержать пробелы, читаем до слова moves
+            while (in >> token && token != "moves")
+                fen += token;
+        }
+        else
+        {
+            send("info string bad position command");
+            return;
+        }
+        vector<string> moves;
+        if (token != "moves")
+            in >> token;
+        while (in >> token)
+            moves.push_back(token);
+        set_position(fen, moves);
+    }
+
+    void go(istringstream &in)
+    {
+        stop_search();
+        int depth = -1;
+        long long movetime = -1, wtime = -1, btime = -1, winc = 0, binc = 0, nodes = 0;
+        bool infinite = false;
+        pondering = false;
+        string token;
+        while (in >> token)
+        {
+            if (token == "depth")
+                in >> depth;
+            else if (token == "movetime")
+                in >> movetime;
+            else if (token == "nodes")
+                in >> nodes;
+            else if (token == "wtime")
+                in >> wtime;
+            else if (token == "btime")
+                in >> btime;
+            else if (token == "winc")
+                in >> winc;
+            else if (token == "binc")
+                in >> binc;
+            else if (token == "infinite")
+                infinite = true;
+            else if (token == "ponder")
+                pondering = true;
+        }
+        // Время на ход из контроля времени: доля оставшегося времени плюс добавка
+        const long long left = (color ? btime : wtime);
+        if (movetime < 0 && left >= 0)
+            movetime = max(1LL, min(left / 30 + (color ? binc : winc), left / 2));
+        if (depth < 0)
+            depth = (movetime >= 0 || nodes > 0 || infinite || pondering) ? max_search_depth : default_depth;
+        // В протоколе глубина считается в полуходах, Max_depth у Logic на единицу меньше
+        depth = max(0, depth - 1);
+
+        // Во время ponder время не ограничено, лимит применяется после ponderhit
+        ponder_movetime = movetime;
+        start_time = chrono::steady_clock::now();
+        logic.limits.clear();
+        if (movetime >= 0 && !pondering)
+            logic.limits.set_movetime(movetime, start_time);
+        logic.limits.max_nodes = max(0LL, nodes);
+        logic.trace = nullptr;
+        if (!trace_file.empty())
+        {
+            if (trace.open(trace_file))
+            {
+                trace.max_ply = trace_depth;
+                logic.trace = &trace;
+            }
+            else
+                send("info string cannot write trace " + trace_file);
+        }
+        stop = false;
+        // без лимитов infinite/ponder ждут stop, даже если поиск закончился раньше
+        wait_for_stop = infinite || pondering;
+        searcher = thread(&Engine::search, this, depth);
+    }
+
+    void ponderhit()
+    {
+        if (!searcher.joinable() || !pondering)
+            return;
+        pondering = false;
+        // Отсчёт времени на ход начинается с ponderhit, поиск останавливается таймером
+        if (ponder_movetime >= 0)
+            start_timer(ponder_movetime);
+        wait_for_stop = false;
+    }
+
+    // Выставляет флаг stop через ms миллисекунд, если таймер не отменён
+    void start_timer(const long long ms)
+    {
+        timer = thread([this, ms] {
+            unique_lock<mutex> lock(timer_mutex);
+            if (!timer_cv.wait_for(lock, chrono::milliseconds(ms), [this] { return timer_cancel; }))
+                stop = true;
+        });
+    }
+
+    void stop_search()
+    {
+        if (searcher.joinable())
+        {
+            stop = true;
+            searcher.join();
+        }
+        if (timer.joinable())
+        {
+            {
+                lock_guard<mutex> lock(timer_mutex);
+                timer_cancel = true;
+            }
+            timer_cv.notify_all();
+            timer.join();
+            timer_cancel = false;
+        }
+    }
+
+    // Итеративное углубление: после каждой досчитанной глубины печатаем info
+    void search(const int depth)
+    {
+        if (multi_pv > 1)
+            return search_lines(depth);
+        const auto best = logic.find_best_turns_iterative(mtx, color, depth, [this](const int d) {
+            const auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start_time);
+            ostringstream info;
+            info << "info depth " << d + 1 << " score " << score_to_string(logic.best_score);
+#ifndef NO_STATS
+            info << " nodes " << logic.stats.total_nodes();
+#endif
+            if (logic.tt)
+                info << " hashfull " << logic.tt->hashfull();
+            info << " time " << ms.count() << " pv " << line_to_string(logic.pv);
+            send(info.str());
+        });
+        finish_trace();
+        // infinite и ponder не отвечают, пока не придёт stop или ponderhit
+        while (wait_for_stop && !stop)
+            this_thread::sleep_for(chrono::milliseconds(1));
+        send("bestmove " + move_to_string(best));
+    }
+
+    // Поиск multi_pv лучших линий: после каждой глубины info для каждой линии
+    void search_lines(const int depth)
+    {
+        const auto lines = logic.find_best_lines(mtx, color, depth, size_t(multi_pv), [this](const int d) {
+            const auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start_time);
+            for (size_t k = 0; k < logic.lines.size(); ++k)
+            {
+                ostringstream info;
+                info << "info depth " << d + 1 << " multipv " << k + 1 << " score "
+                     << score_to_string(logic.lines[k].score);
+#ifndef NO_STATS
+                info << " nodes " << logic.stats.total_nodes();
+#endif
+                info << " time " << ms.count() << " pv " << line_to_string(logic.lines[k].pv);
+                send(info.str());
+            }
+        });
+        finish_trace();
+        while (wait_for_stop && !stop)
+            this_thread::sleep_for(chrono::milliseconds(1));
+        send("bestmove " + move_to_string(lines.empty() ? vector<move_pos>() : lines[0].move.steps()));
+    }
+
+    // Закрывает файл дерева поиска, чтобы его можно было разбирать сразу после bestmove
+    void finish_trace()
+    {
+        if (!logic.trace)
+            return;
+        send("info string trace " + trace_file + " records " + to_string(trace.records()));
+        logic.trace = nullptr;
+        trace.close();
+    }
+
+    Config config;
+    Logic logic;
+    vector<vector<POS_T>> mtx;
+    bool color = 0;
+    // число линий анализа (MultiPV)
+    int multi_pv = 1;
+    // запись дерева поиска: файл (пусто - не пишется) и глубина в полуходах от корня
+    string trace_file;
+    int trace_depth = default_trace_depth;
+    Search_trace trace;
+    // таблица перестановок: размер в МБ (0 - без таблицы) и имя сегмента общей памяти (пусто - своя)
+    int hash_mb = default_hash_mb;
+    string hash_name;
+    Transposition_table tt;
+
+    thread searcher;
+    atomic<bool> stop{false};
+    atomic<bool> wait_for_stop{false};
+    bool pondering = false;
+    long long ponder_movetime = -1;
+    chrono::steady_clock::time_point start_time;
+
+    // таймер времени на ход после ponderhit
+    thread timer;
+    mutex timer_mutex;
+    condition_variable timer_cv;
+    bool timer_cancel = false;
+};
+} // namespace
+
+int main()
+{
+    ios::sync_with_stdio(false);
+    Engine engine;
+    engine.loop();
+    return 0;
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Models/Fen.h"
+#include "../Models/Move.h"
+#include "Logic.h"
+
+using namespace std;
+
+/*
+Разбор сыгранной партии: каждая позиция перед ходом ищется на фиксированную глубину,
+ошибки - ходы, после которых оценка ходящей стороны упала больше чем на blunder_score.
+Позиции независимы, поэтому распределяются по пулу потоков (у каждого потока свой Logic)
+и время разбора падает почти линейно с числом ядер. Оценка сыгранного хода - оценка следующей
+позиции с обратным знаком, лишних поисков не нужно.
+*/
+
+// Разбор одного хода партии
+struct Move_review
+{
+    // сторона, сделавшая ход: 0 - белые, 1 - черные
+    bool color = 0;
+    // сыгранный ход и лучший ход поиска (серия взятий целиком, по перемещениям)
+    vector<move_pos> played;
+    vector<move_pos> best;
+    // оценка позиции перед ходом (лучшего хода) и сыгранного хода с точки зрения сделавшей ход стороны
+    int score = 0;
+    int played_score = 0;
+    bool blunder = false;
+};
+
+struct Game_review
+{
+    // ходы партии по порядку
+    vector<Move_review> moves;
+    // оценки всех позиций партии с точки зрения белых (на одну больше, чем ходов)
+    vector<int> white_scores;
+    unsigned threads = 0;
+    uint64_t nodes = 0;
+    double ms = 0;
+
+    // Запись партии с оценками: строка на ход, ошибки отмечены "??" и лучшим ходом
+    void write(ostream &out) const
+    {
+        out << "Analysis: " << moves.size() << " moves, " << threads << " threads, " << nodes << " nodes, "
+            << int(ms) << " millisec\n";
+        for (size_t k = 0; k < moves.size(); ++k)
+        {
+            const auto &move = moves[k];
+            out << k / 2 + 1 << (move.color ? "... " : ". ") << move_to_string(move.played) << " "
+                << move.played_score;
+            if (move.blunder)
+                out << " ?? best " << move_to_string(move.best) << " " << move.score;
+            out << "\n";
+        }
+    }
+};
+
+// Разбирает партию: positions - позиции перед каждым ходом и последняя (первый ход у белых),
+// level - глубина поиска каждой позиции (как BotLevel), threads - размер пула (0 - все ядра).
+// stop - флаг отмены из другого потока: разбор прерывается, результат неполный
+inline Game_review review_game(Config *config, const vector<vector<vector<POS_T>>> &positions, const int level,
+                               const int blunder_score, unsigned threads = 0, const atomic<bool> *stop = nullptr)
+{
+    const auto start = chrono::steady_clock::now();
+    Game_review review;
+    const size_t count = positions.size();
+    if (!count)
+        return review;
+    if (!threads)
+        threads = max(1u, thread::hardware_concurrency());
+    threads = unsigned(min<size_t>(threads, count));
+    // оценка каждой позиции для ходящей стороны, лучший ход и ход партии из неё
+    vector<int> scores(count, 0);
+    vector<vector<move_pos>> best(count), played(count);
+    atomic<size_t> next{0};
+    atomic<uint64_t> nodes{0};
+    auto worker = [&] {
+        Logic logic(nullptr, config);
+        logic.limits.stop = stop;
+        vector<Logic::Full_move> moves;
+        size_t k;
+        while (!(stop && *stop) && (k = next++) < count)
+        {
+            const bool color = k % 2;
+            // Повторения в поиске распознаются по позициям партии до этой
+            logic.new_game();
+            for (size_t j = 0; j <= k; ++j)
+                logic.history.push(positions[j], j % 2);
+            auto mtx = positions[k];
+            logic.find_moves(color, mtx, moves);
+            if (moves.empty())
+            {
+                // Партия окончена: ходящая сторона проиграла
+                scores[k] = -WIN_SCORE;
+                continue;
+            }
+            best[k] = logic.find_best_turns_iterative(positions[k], color, level);
+            scores[k] = logic.best_score;
+            nodes += logic.searched_nodes;
+            if (k + 1 == count)
+                continue;
+            for (const auto &move : moves)
+            {
+                if (logic.make_move(positions[k], move) == positions[k + 1])
+                {
+                    played[k] = move.steps();
+                    break;
+                }
+            }
+        }
+    };
+    vector<thread> pool;
+    for (unsigned k = 0; k < threads; ++k)
+        pool.emplace_back(worker);
+    for (auto &th : pool)
+        th.join();
+
+    for (size_t k = 0; k < count; ++k)
+        review.white_scores.push_back(k % 2 ? -scores[k] : scores[k]);
+    for (size_t k = 0; k + 1 < count; ++k)
+    {
+        Move_review move;
+        move.color = k % 2;
+        move.played = played[k];
+        move.best = best[k];
+        move.score = scores[k];
+        move.played_score = -scores[k + 1];
+        move.blunder = move.score - move.played_score > blunder_score && move.best != move.played;
+        review.moves.push_back(move);
+    }
+    review.threads = threads;
+    review.nodes = nodes;
+    review.ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return review;
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+
+#include "../Models/Fen.h"
+
+using namespace std;
+
+/*
+Пакетная оценка многих несвязанных позиций 8x8 (инструменты, выгрузка данных, пакеты листьев).
+Позиции хранятся структурой массивов: маски белых, черных и дамок по 32 полям (как fen_position,
+бит n - 1 - поле n) и сторона, с точки зрения которой нужна оценка. Оценка та же, что у
+Logic::calc_score без сети: число пешек и дамок и продвижение пешек, сумма номеров горизонталей
+считается подсчётом битов в масках горизонталей. При сборке с AVX2 (-mavx2 или -march=native)
+считается по 8 позиций за раз, подсчёт битов - по таблице полубайтов; без AVX2 - по одной.
+*/
+struct Position_batch
+{
+    vector<uint32_t> white;
+    vector<uint32_t> black;
+    vector<uint32_t> kings;
+    // сторона оценки: 0 - белые, 1 - черные (как first_bot_color в calc_score)
+    vector<uint8_t> color;
+
+    void add(const fen_position &pos, const bool eval_color)
+    {
+        white.push_back(pos.white);
+        black.push_back(pos.black);
+        kings.push_back(pos.kings);
+        color.push_back(eval_color);
+    }
+    void add(const vector<vector<POS_T>> &mtx, const bool eval_color)
+    {
+        add(from_mtx(mtx, eval_color), eval_color);
+    }
+
+    size_t size() const
+    {
+        return white.size();
+    }
+
+    void clear()
+    {
+        white.clear();
+        black.clear();
+        kings.clear();
+        color.clear();
+    }
+
+    void reserve(const size_t count)
+    {
+        white.reserve(count);
+        black.reserve(count);
+        kings.reserve(count);
+        color.reserve(count);
+    }
+};
+
+// Веса материальной оценки: цены пешки и дамки, прибавка за горизонталь и оценка выигрыша
+struct Material_weights
+{
+    int man = 100;
+    int king = 400;
+    int row = 0;
+    int win = 30000;
+};
+
+namespace batch_eval
+{
+// поля, у которых в номере горизонтали (0 - сторона черных) установлен бит 1, 2 и 4:
+// горизонталь r занимает биты 4r..4r+3
+const uint32_t ROW_BIT1 = 0xF0F0F0F0u;
+const uint32_t ROW_BIT2 = 0xFF00FF00u;
+const uint32_t ROW_BIT4 = 0xFFFF0000u;
+
+// Число единичных битов без команды popcnt (сборка без -mpopcnt)
+inline int bit_count(uint32_t mask)
+{
+    mask = mask - ((mask >> 1) & 0x55555555u);
+    mask = (mask & 0x33333333u) + ((mask >> 2) & 0x33333333u);
+    return int((((mask + (mask >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+}
+
+// Сумма номеров горизонталей шашек mask
+inline int row_sum(const uint32_t mask)
+{
+    return bit_count(mask & ROW_BIT1) + 2 * bit_count(mask & ROW_BIT2) + 4 * bit_count(mask & ROW_BIT4);
+}
+
+// Оценка позиции k с точки зрения batch.color[k]
+inline int score_one(const Position_batch &batch, const size_t k, const Material_weights &weights)
+{
+    const uint32_t w = batch.white[k], b = batch.black[k], kings = batch.kings[k];
+    const uint32_t wm = w & ~kings, bm = b & ~kings;
+    // с точки зрения белых; белая пешка продвинулась на 7 - горизонталь
+    const int white_score = (bit_count(wm) - bit_count(bm)) * weights.man +
+                            (bit_count(w & kings) - bit_count(b & kings)) * weights.king +
+                            (7 * bit_count(wm) - row_sum(wm) - row_sum(bm)) * weights.row;
+    const uint32_t own = batch.color[k] ? b : w, opp = batch.color[k] ? w : b;
+    if (!opp)
+        return weights.win;
+    if (!own)
+        return -weights.win;
+    return batch.color[k] ? -white_score : white_score;
+}
+
+#if defined(__AVX2__)
+// Число единичных битов в каждом 32-битном слове
+inline __m256i popcount32(const __m256i v)
+{
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1, 1, 2, 1, 2, 2, 3, 1,
+                                            2, 2, 3, 2, 3, 3, 4);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    const __m256i bytes = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, _mm256_and_si256(v, nibble)),
+                                          _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+    // сумма четырёх байтов слова: попарно в 16 бит, затем в 32
+    return _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, _mm256_set1_epi8(1)), _mm256_set1_epi16(1));
+}
+
+inline __m256i row_sum8(const __m256i mask)
+{
+    const __m256i r1 = popcount32(_mm256_and_si256(mask, _mm256_set1_epi32(int(ROW_BIT1))));
+    const __m256i r2 = popcount32(_mm256_and_si256(mask, _mm256_set1_epi32(int(ROW_BIT2))));
+    const __m256i r4 = popcount32(_mm256_and_si256(mask, _mm256_set1_epi32(int(ROW_BIT4))));
+    return _mm256_add_epi32(r1, _mm256_add_epi32(_mm256_slli_epi32(r2, 1), _mm256_slli_epi32(r4, 2)));
+}
+
+// Оценки позиций from..from+7
+inline void score_eight(const Position_batch &batch, const size_t from, const Material_weights &weights, int *out)
+{
+    const __m256i w = _mm256_loadu_si256((const __m256i *)(batch.white.data() + from));
+    const __m256i b = _mm256_loadu_si256((const __m256i *)(batch.black.data() + from));
+    const __m256i kings = _mm256_loadu_si256((const __m256i *)(batch.kings.data() + from));
+    const __m256i wm = _mm256_andnot_si256(kings, w), bm = _mm256_andnot_si256(kings, b);
+    const __m256i wm_count = popcount32(wm);
+    const __m256i men = _mm256_sub_epi32(wm_count, popcount32(bm));
+    const __m256i king_count =
+        _mm256_sub_epi32(popcount32(_mm256_and_si256(w, kings)), popcount32(_mm256_and_si256(b, kings)));
+    const __m256i rows = _mm256_sub_epi32(_mm256_mullo_epi32(wm_count, _mm256_set1_epi32(7)),
+                                          _mm256_add_epi32(row_sum8(wm), row_sum8(bm)));
+    __m256i score = _mm256_add_epi32(_mm256_mullo_epi32(men, _mm256_set1_epi32(weights.man)),
+                                     _mm256_mullo_epi32(king_count, _mm256_set1_epi32(weights.king)));
+    score = _mm256_add_epi32(score, _mm256_mullo_epi32(rows, _mm256_set1_epi32(weights.row)));
+
+    // сторона оценки: все биты слова установлены у черных
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i side = _mm256_sub_epi32(
+        zero, _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(batch.color.data() + from))));
+    // у черных оценка с обратным знаком: (s ^ side) - side
+    score = _mm256_sub_epi32(_mm256_xor_si256(score, side), side);
+    const __m256i own = _mm256_blendv_epi8(w, b, side), opp = _mm256_blendv_epi8(b, w, side);
+    const __m256i win = _mm256_set1_epi32(weights.win);
+    score = _mm256_blendv_epi8(score, _mm256_sub_epi32(zero, win), _mm256_cmpeq_epi32(own, zero));
+    score = _mm256_blendv_epi8(score, win, _mm256_cmpeq_epi32(opp, zero));
+    _mm256_storeu_si256((__m256i *)out, score);
+}
+#endif
+} // namespace batch_eval
+
+// Оценки позиций batch с точки зрения batch.color в out (batch.size() значений)
+inline void material_scores(const Position_batch &batch, const Material_weights &weights, int *out)
+{
+    size_t k = 0;
+#if defined(__AVX2__)
+    for (; k + 8 <= batch.size(); k += 8)
+        batch_eval::score_eight(batch, k, weights, out + k);
+#endif
+    for (; k < batch.size(); ++k)
+        out[k] = batch_eval::score_one(batch, k, weights);
+}
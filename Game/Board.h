@@ -1,9 +1,13 @@
 ﻿#pragma once
+#include <chrono>
 #include <iostream>
 #include <fstream>
+#include <thread>
 #include <vector>
 
+#include "../Models/Log.h"
 #include "../Models/Move.h"
+#include "../Models/Rules.h"
 #include "../Models/Project_path.h"
 
 #ifdef __APPLE__
@@ -19,29 +23,44 @@ using namespace std;
 class Board
 {
 public:
+    // Доска рисуется по текстуре 8x8: играются русские шашки
+    using Rules = Russian_rules;
+
     Board() = default;
     Board(const unsigned int W, const unsigned int H) : W(W), H(H)
     {
     }
 
     // draws start board
+    // Картинки декодируются в фоновом потоке, пока создаются окно и рендерер; первый кадр рисуется
+    // без текстур (draw_placeholder), текстуры создаются из готовых картинок сразу после него
     int start_draw()
     {
-        // Инициализация библиотеки SDL
-        if (SDL_Init(SDL_INIT_EVERYTHING) != 0)
-        {
-            print_exception("SDL_Init can't init SDL2 lib");
+        const string paths[MAIN_TEXTURES] = { board_path, piece_white_path, piece_black_path, queen_white_path,
+                                              queen_black_path, back_path, replay_path };
+        SDL_Surface* surfaces[MAIN_TEXTURES] = {};
+        thread loader([&] {
+            for (int k = 0; k < MAIN_TEXTURES; ++k)
+                surfaces[k] = IMG_Load(paths[k].c_str());
+        });
+        // При ошибке дожидаемся фонового потока и освобождаем картинки
+        auto fail = [&](const string& text) {
+            print_exception(text);
+            if (loader.joinable())
+                loader.join();
+            for (auto* surface : surfaces)
+                SDL_FreeSurface(surface);
             return 1;
-        }
+        };
+        // Инициализация библиотеки SDL: только окно и события, звук и джойстики игре не нужны
+        if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0)
+            return fail("SDL_Init can't init SDL2 lib");
         // Установка размеров окна, если они еще не заданы
         if (W == 0 || H == 0)
         {
             SDL_DisplayMode dm;
             if (SDL_GetDesktopDisplayMode(0, &dm))
-            {
-                print_exception("SDL_GetDesktopDisplayMode can't get desctop display mode");
-                return 1;
-            }
+                return fail("SDL_GetDesktopDisplayMode can't get desctop display mode");
             W = min(dm.w, dm.h);
             W -= W / 15;
             H = W;
@@ -49,34 +68,32 @@ public:
         // Создание окна
         win = SDL_CreateWindow("Checkers", 0, H / 30, W, H, SDL_WINDOW_RESIZABLE);
         if (win == nullptr)
-        {
-            print_exception("SDL_CreateWindow can't create window");
-            return 1;
-        }
+            return fail("SDL_CreateWindow can't create window");
         // Создание рендерера
         ren = SDL_CreateRenderer(win, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
         if (ren == nullptr)
-        {
-            print_exception("SDL_CreateRenderer can't create renderer");
-            return 1;
-        }
-        // Загрузка текстур
-        board = IMG_LoadTexture(ren, board_path.c_str());
-        w_piece = IMG_LoadTexture(ren, piece_white_path.c_str());
-        b_piece = IMG_LoadTexture(ren, piece_black_path.c_str());
-        w_queen = IMG_LoadTexture(ren, queen_white_path.c_str());
-        b_queen = IMG_LoadTexture(ren, queen_black_path.c_str());
-        back = IMG_LoadTexture(ren, back_path.c_str());
-        replay = IMG_LoadTexture(ren, replay_path.c_str());
-        if (!board || !w_piece || !b_piece || !w_queen || !b_queen || !back || !replay)
-        {
-            print_exception("IMG_LoadTexture can't load main textures from " + textures_path);
-            return 1;
-        }
+            return fail("SDL_CreateRenderer can't create renderer");
         // Получение реальных размеров окна
         SDL_GetRendererOutputSize(ren, &W, &H);
         // Создание начальной матрицы состояния игры
         make_start_mtx();
+        // Первый кадр, пока картинки ещё декодируются
+        draw_placeholder();
+        first_frame_time = chrono::steady_clock::now();
+        // Текстуры создаются в потоке рендерера из декодированных картинок
+        loader.join();
+        SDL_Texture** textures[MAIN_TEXTURES] = { &board, &w_piece, &b_piece, &w_queen, &b_queen, &back, &replay };
+        bool loaded = true;
+        for (int k = 0; k < MAIN_TEXTURES; ++k)
+        {
+            *textures[k] = surfaces[k] ? SDL_CreateTextureFromSurface(ren, surfaces[k]) : nullptr;
+            SDL_FreeSurface(surfaces[k]);
+            surfaces[k] = nullptr;
+            loaded = loaded && *textures[k];
+        }
+        if (!loaded)
+            return fail("IMG_Load can't load main textures from " + textures_path);
+        textures_time = chrono::steady_clock::now();
         // Перерисовка сцены
         rerender();
         // Успешное завершение
@@ -91,6 +108,9 @@ public:
         history_mtx.clear();
         // Очищаем историю серий ударов
         history_beat_series.clear();
+        // Убираем разбор прошлой партии
+        analysis_scores.clear();
+        analysis_blunders.clear();
         // Восстанавливаем начальную позицию
         make_start_mtx();
         // Очищаем активные элементы
@@ -124,7 +144,7 @@ public:
             throw runtime_error("begin position is empty, can't move");
         }
         // Если простая фигура дошла до конца поля, превращаем её в королеву
-        if ((mtx[i][j] == 1 && i2 == 0) || (mtx[i][j] == 2 && i2 == 7))
+        if (mtx[i][j] <= 2 && i2 == Rules::promotion_row(mtx[i][j]))
             mtx[i][j] += 2;
         // Перемещаем фигуру
         mtx[i2][j2] = mtx[i][j];
@@ -176,9 +196,9 @@ public:
     void clear_highlight()
     {
         // Очищаем массив подсветок для каждой строки
-        for (POS_T i = 0; i < 8; ++i)
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
         {
-            is_highlighted_[i].assign(8, 0);
+            is_highlighted_[i].assign(Rules::SIZE, 0);
         }
         rerender();
     }
@@ -237,6 +257,28 @@ public:
         rerender();
     }
 
+    // Позиции перед каждым полным ходом партии и последняя позиция (серия взятий - один ход)
+    vector<vector<vector<POS_T>>> game_positions() const
+    {
+        vector<vector<vector<POS_T>>> res;
+        for (size_t k = 0; k < history_mtx.size(); ++k)
+        {
+            // следующий ход начинается, если перемещение не продолжает серию взятий
+            if (k + 1 == history_mtx.size() || history_beat_series[k + 1] <= 1)
+                res.push_back(history_mtx[k]);
+        }
+        return res;
+    }
+
+    // Показывает под доской разбор партии: оценки позиций с точки зрения белых,
+    // ходы-ошибки (blunders[k] - ход из позиции k) выделены красным
+    void show_analysis(const vector<int>& scores, const vector<bool>& blunders)
+    {
+        analysis_scores = scores;
+        analysis_blunders = blunders;
+        rerender();
+    }
+
     // use if window size changed
     void reset_window_size()
     {
@@ -279,14 +321,14 @@ private:
     // Функция для создания стартовой конфигурации доски
     void make_start_mtx()
     {
-        for (POS_T i = 0; i < 8; ++i)
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
         {
-            for (POS_T j = 0; j < 8; ++j)
+            for (POS_T j = 0; j < Rules::SIZE; ++j)
             {
                 mtx[i][j] = 0;
-                if (i < 3 && (i + j) % 2 == 1)
+                if (i < Rules::START_ROWS && (i + j) % 2 == 1)
                     mtx[i][j] = 2;
-                if (i > 4 && (i + j) % 2 == 1)
+                if (i >= Rules::SIZE - Rules::START_ROWS && (i + j) % 2 == 1)
                     mtx[i][j] = 1;
             }
         }
@@ -294,6 +336,34 @@ private:
         add_history();
     }
 
+    // Кадр без текстур при запуске: клетки доски и шашки цветными прямоугольниками
+    void draw_placeholder()
+    {
+        SDL_SetRenderDrawColor(ren, 120, 80, 40, 255);
+        SDL_RenderClear(ren);
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
+        {
+            for (POS_T j = 0; j < Rules::SIZE; ++j)
+            {
+                SDL_Rect cell{ W * (j + 1) / 10, H * (i + 1) / 10, W / 10, H / 10 };
+                if ((i + j) % 2)
+                    SDL_SetRenderDrawColor(ren, 90, 60, 30, 255);
+                else
+                    SDL_SetRenderDrawColor(ren, 240, 220, 180, 255);
+                SDL_RenderFillRect(ren, &cell);
+                if (!mtx[i][j])
+                    continue;
+                SDL_Rect piece{ W * (j + 1) / 10 + W / 120, H * (i + 1) / 10 + H / 120, W / 12, H / 12 };
+                if (mtx[i][j] % 2)
+                    SDL_SetRenderDrawColor(ren, 245, 245, 245, 255);
+                else
+                    SDL_SetRenderDrawColor(ren, 30, 30, 30, 255);
+                SDL_RenderFillRect(ren, &piece);
+            }
+        }
+        SDL_RenderPresent(ren);
+    }
+
     // function that re-draw all the textures
     // Функция для перерисовки всех текстур
     void rerender()
@@ -306,9 +376,9 @@ private:
 
         // draw pieces
         // Рисуем шашки
-        for (POS_T i = 0; i < 8; ++i)
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
         {
-            for (POS_T j = 0; j < 8; ++j)
+            for (POS_T j = 0; j < Rules::SIZE; ++j)
             {
                 // Пропускаем пустые клетки
                 if (!mtx[i][j])
@@ -339,9 +409,9 @@ private:
         const double scale = 2.5;
         // Масштабируем сетку
         SDL_RenderSetScale(ren, scale, scale);
-        for (POS_T i = 0; i < 8; ++i)
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
         {
-            for (POS_T j = 0; j < 8; ++j)
+            for (POS_T j = 0; j < Rules::SIZE; ++j)
             {
                 // Пропускаем неотмеченные клетки
                 if (!is_highlighted_[i][j])
@@ -400,6 +470,34 @@ private:
             SDL_DestroyTexture(result_texture);
         }
 
+        // draw analysis
+        // График оценок партии в нижнем поле: столбец на позицию, вверх - перевес белых
+        if (!analysis_scores.empty())
+        {
+            const int left = W / 10, width = W * 8 / 10;
+            const int mid = H * 19 / 20, half = H / 25;
+            // оценка, при которой столбец доходит до края поля (5 шашек)
+            const int limit = 500;
+            const int count = int(analysis_scores.size());
+            SDL_SetRenderDrawColor(ren, 128, 128, 128, 255);
+            SDL_RenderDrawLine(ren, left, mid, left + width, mid);
+            for (int k = 0; k < count; ++k)
+            {
+                const int score = max(-limit, min(limit, analysis_scores[k]));
+                const int height = score * half / limit;
+                SDL_Rect bar{ left + width * k / count, height > 0 ? mid - height : mid,
+                              max(1, width / count - 1), max(1, abs(height)) };
+                // ошибка - ход, после которого получилась позиция k
+                if (k > 0 && k - 1 < int(analysis_blunders.size()) && analysis_blunders[k - 1])
+                    SDL_SetRenderDrawColor(ren, 220, 30, 30, 255);
+                else if (score >= 0)
+                    SDL_SetRenderDrawColor(ren, 245, 245, 245, 255);
+                else
+                    SDL_SetRenderDrawColor(ren, 30, 30, 30, 255);
+                SDL_RenderFillRect(ren, &bar);
+            }
+        }
+
         // Обновляем экран
         SDL_RenderPresent(ren);
         // next rows for mac os
@@ -409,7 +507,7 @@ private:
     }
 
     void print_exception(const string& text) {
-        ofstream fout(project_path + "log.txt", ios_base::app);
+        auto fout = open_log();
         fout << "Error: " << text << ". "<< SDL_GetError() << endl;
         fout.close();
     }
@@ -420,6 +518,9 @@ private:
     // history of boards
     // История
     vector<vector<vector<POS_T>>> history_mtx;
+    // время запуска: первый кадр и готовые текстуры (start_draw)
+    chrono::steady_clock::time_point first_frame_time;
+    chrono::steady_clock::time_point textures_time;
 
   private:
     SDL_Window *win = nullptr;
@@ -433,6 +534,8 @@ private:
     SDL_Texture *b_queen = nullptr;
     SDL_Texture *back = nullptr;
     SDL_Texture *replay = nullptr;
+    // число текстур, которые start_draw загружает до первой партии
+    static const int MAIN_TEXTURES = 7;
     // texture files names
     // Имена файлов текстур
     const string textures_path = project_path + "Textures/";
@@ -452,14 +555,17 @@ private:
     // game result if exist
     // Результат игры
     int game_results = -1;
+    // разбор партии для графика под доской (show_analysis)
+    vector<int> analysis_scores;
+    vector<bool> analysis_blunders;
     // matrix of possible moves
     // Матрица возможных ходов, которые подсвечиваются
-    vector<vector<bool>> is_highlighted_ = vector<vector<bool>>(8, vector<bool>(8, 0));
+    vector<vector<bool>> is_highlighted_ = vector<vector<bool>>(Rules::SIZE, vector<bool>(Rules::SIZE, 0));
     // matrix of possible moves
     // 1 - white, 2 - black, 3 - white queen, 4 - black queen
     // Состояния доски, где значения 1, 2, 3 и 4 обозначают 
     // белый, черный, белую королеву и черную королеву соответственно
-    vector<vector<POS_T>> mtx = vector<vector<POS_T>>(8, vector<POS_T>(8, 0));
+    vector<vector<POS_T>> mtx = vector<vector<POS_T>>(Rules::SIZE, vector<POS_T>(Rules::SIZE, 0));
     // series of beats for each move
     // Серия ударов
     vector<int> history_beat_series;
@@ -1,9 +1,20 @@
-﻿#pragma once
+#pragma once
+#include <atomic>
 #include <fstream>
+#include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
+#include <thread>
 using json = nlohmann::json;
 
+#ifdef __linux__
+    #include <poll.h>
+    #include <sys/inotify.h>
+    #include <unistd.h>
+#endif
+
 #include "../Models/Project_path.h"
+#include "../Models/Settings.h"
 
 class Config
 {
@@ -12,27 +23,153 @@ class Config
     {
         reload();
     }
+    Config(const Config &other) : config(other.get_json()), current(other.settings())
+    {
+    }
+    Config &operator=(const Config &other)
+    {
+        if (this != &other)
+        {
+            auto other_json = other.get_json();
+            auto other_settings = other.settings();
+            lock_guard<mutex> lock(json_mutex);
+            config = move(other_json);
+            atomic_store(&current, other_settings);
+        }
+        return *this;
+    }
+    ~Config()
+    {
+        stop_watching();
+    }
     /*
     Метод reload() отвечает за чтение файла settings.json и сохранение его содержимого в объект config.
     Этот метод выполняется всякий раз, когда происходит изменение файла settings.json,
     чтобы гарантировать актуальность данных в объекте config.
+    Файл с синтаксической ошибкой не применяется, пока его не исправят (кроме первого чтения).
     */
     void reload()
     {
         std::ifstream fin(project_path + "settings.json");
-        fin >> config;
+        json loaded = json::parse(fin, nullptr, false);
         fin.close();
+        if (loaded.is_discarded())
+        {
+            if (settings())
+                return;
+            loaded = json::object();
+        }
+        lock_guard<mutex> lock(json_mutex);
+        config = move(loaded);
+        publish();
     }
 
     /*
     Оператор () используется для доступа к паре (ключ, значение) из setting.json,
     например, (Height, 0) или (IsWhiteBot, false)
     */
-    auto operator()(const string &setting_dir, const string &setting_name) const
+    json operator()(const string &setting_dir, const string &setting_name) const
     {
+        lock_guard<mutex> lock(json_mutex);
         return config[setting_dir][setting_name];
     }
 
+    /*
+    Метод set() переопределяет значение настройки в памяти, не изменяя settings.json.
+    Используется инструментами (бенчмарки, движок), которым нужны свои параметры.
+    */
+    void set(const string &setting_dir, const string &setting_name, const json &value)
+    {
+        lock_guard<mutex> lock(json_mutex);
+        config[setting_dir][setting_name] = value;
+        publish();
+    }
+
+    /*
+    Метод settings() возвращает разобранные и проверенные настройки.
+    Снимок не меняется, пока его держат: новые значения после перезагрузки
+    подменяют указатель целиком, поэтому игра берёт снимок один раз на ход.
+    */
+    shared_ptr<const Settings> settings() const
+    {
+        return atomic_load(&current);
+    }
+
+    /*
+    Метод watch() запускает фоновое слежение за settings.json (inotify, только Linux):
+    после каждой записи файла настройки перечитываются. На других системах
+    настройки перечитываются только при повторе игры.
+    */
+    void watch()
+    {
+#ifdef __linux__
+        if (watcher.joinable())
+            return;
+        const int fd = inotify_init1(IN_NONBLOCK);
+        if (fd < 0)
+            return;
+        // Следим за каталогом: редакторы часто заменяют файл новым
+        const string dir = project_path.empty() ? string(".") : project_path;
+        if (inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+        {
+            close(fd);
+            return;
+        }
+        watching = true;
+        watcher = thread([this, fd] {
+            alignas(inotify_event) char buf[4096];
+            while (watching)
+            {
+                pollfd pfd{fd, POLLIN, 0};
+                // Короткий таймаут, чтобы поток быстро завершался при выходе
+                if (poll(&pfd, 1, 200) <= 0)
+                    continue;
+                bool changed = false;
+                ssize_t len;
+                while ((len = read(fd, buf, sizeof(buf))) > 0)
+                {
+                    for (ssize_t k = 0; k < len;)
+                    {
+                        const auto *event = (const inotify_event *)(buf + k);
+                        if (event->len && string(event->name) == "settings.json")
+                            changed = true;
+                        k += sizeof(inotify_event) + event->len;
+                    }
+                }
+                if (changed)
+                    reload();
+            }
+            close(fd);
+        });
+#endif
+    }
+
+    void stop_watching()
+    {
+        watching = false;
+        if (watcher.joinable())
+            watcher.join();
+    }
+
   private:
+    json get_json() const
+    {
+        lock_guard<mutex> lock(json_mutex);
+        return config;
+    }
+
+    // Разбирает json в новый снимок настроек и подменяет текущий (вызывается под json_mutex)
+    void publish()
+    {
+        auto parsed = make_shared<Settings>(Settings::parse(config));
+        auto old = settings();
+        parsed->version = old ? old->version + 1 : 0;
+        atomic_store(&current, shared_ptr<const Settings>(parsed));
+    }
+
     json config;
+    mutable mutex json_mutex;
+    shared_ptr<const Settings> current;
+    thread watcher;
+    atomic<bool> watching{false};
 };
@@ -1,65 +1,130 @@
 ﻿#pragma once
+#include <atomic>
 #include <chrono>
 #include <thread>
 
+#include "../Models/Experience_file.h"
+#include "../Models/Log.h"
 #include "../Models/Project_path.h"
+#include "Analysis.h"
 #include "Board.h"
 #include "Config.h"
 #include "Hand.h"
 #include "Logic.h"
+#include "Pn_solver.h"
+
+// Момент запуска программы (статическая инициализация, до main): от него считается время до первого кадра
+inline const chrono::steady_clock::time_point program_start = chrono::steady_clock::now();
 
 class Game
 {
   public:
-    Game() : board(config("WindowSize", "Width"), config("WindowSize", "Hight")), hand(&board), logic(&board, &config)
+    Game()
+        : board(config.settings()->width, config.settings()->height), hand(&board), logic(&board, &config), solver(&logic)
     {
-        ofstream fout(project_path + "log.txt", ios_base::trunc);
-        fout.close();
+        log_settings_warnings(*config.settings());
+        load_experience();
+        // Изменения settings.json применяются между ходами, без перезапуска
+        config.watch();
     }
 
     // to start checkers
+    // Партии играются в цикле, пока пользователь выбирает повтор: объект логики и стек не растут
     int play()
     {
-        // Запуск таймера игры
-        auto start = chrono::steady_clock::now();
-        // При обновлении доски обновляем логику и перерисовываем доску
-        if (is_replay)
+        while (true)
         {
-            // Создаем объект логики игры
-            logic = Logic(&board, &config);
-            // Заново загружаем настройки
-            config.reload();
-            // Перерисовываем игровое поле
-            board.redraw();
+            const int res = play_game();
+            save_experience();
+            // Выход из игры
+            if (res == -1)
+                return 0;
+            // Повтор во время партии
+            if (res == -2)
+            {
+                start_replay();
+                continue;
+            }
+            // Показываем финальный экран
+            board.show_final(res);
+            // Ожидаем ответ от пользователя после окончания игры, тем временем партия разбирается
+            auto resp = analyze_and_wait();
+            // Если пользователь хочет повторить игру, начинаем новую партию
+            if (resp != Response::REPLAY)
+                return res;
+            start_replay();
         }
-        else
+    }
+
+  private:
+    // Подготовка к повтору: та же логика без пересоздания, настройки перечитываются, поле перерисовывается
+    void start_replay()
+    {
+        logic.new_game();
+        // Заново загружаем настройки
+        config.reload();
+        // Перерисовываем игровое поле
+        board.redraw();
+    }
+
+    // Одна партия. Возвращает результат (0 - ничья, 1 - победа белых, 2 - победа черных),
+    // -1 при выходе из игры и -2 при повторе во время партии
+    int play_game()
+    {
+        // Запуск таймера игры
+        auto start = chrono::steady_clock::now();
+        // Первая партия начинает рисовать доску, при повторе поле уже перерисовано
+        if (!is_started)
         {
-            // Начинаем рисовать новую игру
-            board.start_draw();
+            if (board.start_draw() == 0)
+                log_startup();
+            is_started = true;
         }
-        // Сбрасываем флаг повтора
-        is_replay = false;
         // Переменная для отслеживания количества ходов
         int turn_num = -1;
         // Флаг выхода из игры
         bool is_quit = false;
+        // Флаг повтора игры
+        bool is_replay = false;
+        // Ничья повторением позиции или по правилу 15 ходов дамками
+        bool is_draw = false;
         // Максимальное количество ходов берем из settings.json
-        const int Max_turns = config("Game", "MaxNumTurns");
+        int Max_turns = config.settings()->max_num_turns;
 
         // Игра идёт до победы кого-то или достижения максимального количества ходов
         while (++turn_num < Max_turns)
         {
+            // Снимок настроек на этот ход: новые значения из settings.json подхватываются между ходами
+            const auto settings = config.settings();
+            if (settings->version != logic.configured_version)
+            {
+                const uint64_t old_eval = logic.eval_fingerprint;
+                logic.configure(*settings);
+                // Оценки в таблице посчитаны прежней оценкой (BotScoringType, параметры, сеть)
+                if (logic.eval_fingerprint != old_eval)
+                    tt.clear();
+                log_settings_warnings(*settings);
+            }
+            Max_turns = settings->max_num_turns;
             // Обнуляем переменную серии ударов
             beat_series = 0;
+            // Позиция перед ходом попадает в историю партии (после отката лишние записи удаляются)
+            logic.history.resize(turn_num);
+            logic.history.push(board.get_board(), turn_num % 2);
+            if (logic.history.is_game_draw())
+            {
+                is_draw = true;
+                break;
+            }
             // Находим возможные ходы
             logic.find_turns(turn_num % 2);
             // Если нет возможных ходов, выходим из цикла
             if (logic.turns.empty())
                 break;
             // Устанавливаем глубину поиска в зависимости от уровня бота из setting.json
-            logic.Max_depth = config("Bot", string((turn_num % 2) ? "Black" : "White") + string("BotLevel"));
+            logic.Max_depth = settings->bot_level(turn_num % 2);
             // Проверяем, является ли текущий игрок ботом
-            if (!config("Bot", string("Is") + string((turn_num % 2) ? "Black" : "White") + string("Bot")))
+            if (!settings->is_bot(turn_num % 2))
             {
                 // ход игрока
                 auto resp = player_turn(turn_num % 2);
@@ -79,8 +144,7 @@ class Game
                 // Откатываем состояние доски
                 else if (resp == Response::BACK)
                 {
-                    if (config("Bot", string("Is") + string((1 - turn_num % 2) ? "Black" : "White") + string("Bot")) &&
-                        !beat_series && board.history_mtx.size() > 2)
+                    if (settings->is_bot(1 - turn_num % 2) && !beat_series && board.history_mtx.size() > 2)
                     {
                         board.rollback();
                         --turn_num;
@@ -100,19 +164,18 @@ class Game
         // Останавливаем таймер
         auto end = chrono::steady_clock::now();
         // Запись времени игры в файл log.txt
-        ofstream fout(project_path + "log.txt", ios_base::app);
+        auto fout = open_log();
         fout << "Game time: " << (int)chrono::duration<double, milli>(end - start).count() << " millisec\n";
         fout.close();
 
-        // Если нужно повторить игру, вызывается функция `play()` рекурсивно
         if (is_replay)
-            return play();
-        // Если игра была завершена досрочно, возвращаем 0
+            return -2;
+        // Если игра была завершена досрочно
         if (is_quit)
-            return 0;
+            return -1;
         // Определяем результат игры
         int res = 2;
-        if (turn_num == Max_turns)
+        if (turn_num >= Max_turns || is_draw)
         {
             res = 0;
         }
@@ -120,21 +183,126 @@ class Game
         {
             res = 1;
         }
-        // Показываем финальный экран
-        board.show_final(res);
-        // Ожидаем ответ от пользователя после окончания игры
-        auto resp = hand.wait();
-        // Если пользователь хочет повторить игру, вызываем функцию `play()` снова
-        if (resp == Response::REPLAY)
+        return res;
+    }
+
+    // Ожидание ответа пользователя на финальном экране и разбор окончившейся партии в фоновом потоке:
+    // окно продолжает обрабатывать события, а когда разбор готов, запись с оценками и ошибками
+    // попадает в log.txt и под доской рисуется график. Ответ до конца разбора отменяет его
+    Response analyze_and_wait()
+    {
+        const auto settings = config.settings();
+        const auto positions = board.game_positions();
+        if (settings->analysis_level < 0 || positions.size() < 2)
+            return hand.wait();
+        atomic<bool> cancel{false}, done{false};
+        Game_review review;
+        thread th([&] {
+            review = review_game(&config, positions, settings->analysis_level, settings->blunder_score, 0, &cancel);
+            done = true;
+        });
+        bool shown = false;
+        const auto resp = hand.wait([&] {
+            if (shown)
+                return;
+            // поток окна не отнимает ядро у разбора
+            if (!done)
+            {
+                SDL_Delay(5);
+                return;
+            }
+            shown = true;
+            auto fout = open_log();
+            review.write(fout);
+            fout.close();
+            vector<bool> blunders;
+            for (const auto &move : review.moves)
+                blunders.push_back(move.blunder);
+            board.show_analysis(review.white_scores, blunders);
+        });
+        cancel = true;
+        th.join();
+        return resp;
+    }
+
+    // Таблица перестановок бота и опыт прошлых запусков в ней. Таблица живёт весь запуск:
+    // позиции прошлых партий ищутся быстрее
+    void load_experience()
+    {
+        const Settings &settings = *config.settings();
+        if (!settings.hash_mb)
+            return;
+        tt.resize(size_t(settings.hash_mb));
+        logic.tt = &tt;
+        if (settings.experience_file.empty())
+            return;
+        const auto start = chrono::steady_clock::now();
+        experience.max_records = size_t(settings.experience_mb) * 1024 * 1024 / sizeof(Experience_record);
+        const size_t count = experience.load(project_path + settings.experience_file, tt, Board::Rules::SIZE,
+                                             int(settings.scoring), logic.eval_fingerprint);
+        auto fout = open_log();
+        fout << "Experience: loaded " << count << " records in "
+             << (int)chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " millisec\n";
+        fout.close();
+    }
+
+    // Сохраняет глубокие результаты поиска партии в файл опыта
+    void save_experience()
+    {
+        const Settings &settings = *config.settings();
+        if (!logic.tt || settings.experience_file.empty())
+            return;
+        vector<uint64_t> played;
+        const auto positions = board.game_positions();
+        for (size_t k = 0; k < positions.size(); ++k)
+            played.push_back(Zobrist::hash<Board::Rules::SIZE>(positions[k], k % 2));
+        experience.max_records = size_t(settings.experience_mb) * 1024 * 1024 / sizeof(Experience_record);
+        if (!experience.save(project_path + settings.experience_file, tt, played, Board::Rules::SIZE,
+                             int(settings.scoring), logic.eval_fingerprint))
         {
-            is_replay = true;
-            return play();
+            auto fout = open_log();
+            fout << "Experience: can't write " << project_path + settings.experience_file << "\n";
+            fout.close();
         }
-        // Возвращаем результат игры
-        return res;
     }
 
-  private:
+    // Записывает в log.txt время от запуска до первого кадра и до готовых текстур
+    void log_startup()
+    {
+        auto fout = open_log();
+        fout << "Startup: first frame "
+             << (int)chrono::duration<double, milli>(board.first_frame_time - program_start).count()
+             << " millisec, textures "
+             << (int)chrono::duration<double, milli>(board.textures_time - program_start).count() << " millisec\n";
+        fout.close();
+    }
+
+    // Записывает ошибки в settings.json в log.txt
+    void log_settings_warnings(const Settings &settings)
+    {
+        if (settings.warnings.empty())
+            return;
+        auto fout = open_log();
+        for (const auto &warning : settings.warnings)
+            fout << "Settings: " << warning << "\n";
+        fout.close();
+    }
+
+    // Ход, выигрыш после которого доказан решателем, или пустой ход, если фигур много или выигрыш не найден
+    vector<move_pos> solver_turns(const bool color)
+    {
+        const Settings &settings = *config.settings();
+        int pieces = 0;
+        for (const auto &row : board.get_board())
+            pieces += int(count_if(row.begin(), row.end(), [](const POS_T cell) { return cell != 0; }));
+        if (pieces > settings.solver_pieces)
+            return {};
+        solver.limits.max_nodes = uint64_t(settings.solver_nodes);
+        if (solver.solve(board.get_board(), color, logic.history) != Pn_solver::Result::Win || solver.line.empty())
+            return {};
+        return solver.line.front().steps();
+    }
+
     // Описывает ход бота
     void bot_turn(const bool color)
     {
@@ -142,12 +310,14 @@ class Game
         auto start = chrono::steady_clock::now();
 
         // Берет задержку перед ходом бота из Settings.json
-        auto delay_ms = config("Bot", "BotDelayMS");
+        const Uint32 delay_ms = config.settings()->bot_delay_ms;
         // new thread for equal delay for each turn
         // Создает поток для управления задержкой
         thread th(SDL_Delay, delay_ms);
-        // Находит наилучший ход бота
-        auto turns = logic.find_best_turns(color);
+        // Доказанный выигрыш решателя, иначе наилучший ход поиска
+        auto turns = solver_turns(color);
+        if (turns.empty())
+            turns = logic.find_best_turns(color);
         // Слияние потоков
         th.join();
         // Является ли ход первым
@@ -171,8 +341,15 @@ class Game
         //Завершение работы таймера
         auto end = chrono::steady_clock::now();
         // Запись времени хода бота в log.txt
-        ofstream fout(project_path + "log.txt", ios_base::app);
+        auto fout = open_log();
         fout << "Bot turn time: " << (int)chrono::duration<double, milli>(end - start).count() << " millisec\n";
+#ifndef NO_STATS
+        // Запись статистики поиска
+        const auto &stats = logic.stats;
+        fout << "Search: nodes " << stats.total_nodes() << ", depth " << stats.max_ply() << ", branching "
+             << stats.branching_factor() << ", first cutoffs " << stats.first_cutoff_rate() * 100 << "%, movegen "
+             << stats.movegen_ns / 1000000 << " ms, eval " << stats.eval_ns / 1000000 << " ms\n";
+#endif
         fout.close();
     }
 
@@ -311,6 +488,11 @@ class Game
     Board board;
     Hand hand;
     Logic logic;
+    Pn_solver solver;
+    // таблица перестановок бота (HashMB) и файл опыта
+    Transposition_table tt{0};
+    Experience_file experience;
     int beat_series;
-    bool is_replay = false;
+    // была ли уже нарисована доска
+    bool is_started = false;
 };
@@ -1,4 +1,5 @@
 ﻿#pragma once
+#include <functional>
 #include <tuple>
 
 #include "../Models/Move.h"
@@ -87,8 +88,9 @@ class Hand
         return {resp, xc, yc};
     }
 
-    // Метод для ожидания реакции пользователя после окончания игры
-    Response wait() const
+    // Метод для ожидания реакции пользователя после окончания игры.
+    // idle вызывается, когда событий нет (фоновая работа, которой нужен поток окна)
+    Response wait(const function<void()> &idle = nullptr) const
     {
         // Объект для хранения событий SDL
         SDL_Event windowEvent;
@@ -130,6 +132,8 @@ class Hand
                 if (resp != Response::OK)
                     break;
             }
+            else if (idle)
+                idle();
         }
         // Возвращает ответ
         return resp;
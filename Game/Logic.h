@@ -1,48 +1,255 @@
 ﻿#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <functional>
 #include <random>
 #include <vector>
 
+#include "../Models/Eval_params.h"
+#include "../Models/Log.h"
 #include "../Models/Move.h"
+#include "../Models/Position_history.h"
+#include "../Models/Pv_table.h"
+#include "../Models/Rules.h"
+#include "../Models/Search_limits.h"
+#include "../Models/Search_stats.h"
+#include "../Models/Search_trace.h"
+#include "../Models/Transposition_table.h"
+#include "Batch_eval.h"
 #include "Board.h"
 #include "Config.h"
+#include "Nnue.h"
 
-const int INF = 1e9;
+// Оценки целочисленные, в сотых долях шашки, с точки зрения бота.
+// Выигрыш через ply полуходов оценивается как WIN_SCORE - ply, проигрыш - как ply - WIN_SCORE,
+// поэтому бот выбирает самый быстрый выигрыш и самый долгий проигрыш.
+// Все оценки помещаются в 16 бит
+const int WIN_SCORE = 30000;
+// граница окна поиска, больше любой оценки
+const int INF = 31000;
+// оценки ближе MAX_PLY к WIN_SCORE означают найденный выигрыш или проигрыш
+inline bool is_win_score(const int score)
+{
+    return abs(score) >= WIN_SCORE - SearchStats::MAX_PLY;
+}
+
+// Запись оценки для протоколов: "cp 120" или "win 3" / "loss 2" (число ходов до конца партии)
+inline string score_to_string(const int score)
+{
+    if (!is_win_score(score))
+        return "cp " + to_string(score);
+    const int plies = WIN_SCORE - abs(score);
+    return string(score > 0 ? "win " : "loss ") + to_string((plies + 1) / 2);
+}
 
-class Logic
+// Движок для варианта правил Rules (Models/Rules.h): размер доски, направления взятий, дамки,
+// превращение и правило большинства известны при компиляции. Игра и инструменты используют Logic -
+// движок русских шашек 8x8. Оценка сетью есть только у русских шашек (признаки сети - клетки 8x8)
+template <class Rules> class Basic_logic
 {
   public:
-    Logic(Board *board, Config *config) : board(board), config(config)
+    // полный ход варианта
+    using Full_move = Basic_full_move<Rules>;
+
+    // Линия анализа корня: полный ход (с серией взятий), главный вариант по перемещениям
+    // (начинается с этого хода) и оценка с точки зрения ходящей стороны
+    struct Root_line
+    {
+        Full_move move;
+        vector<move_pos> pv;
+        int score = 0;
+    };
+
+    Basic_logic(Board *board, Config *config) : network(load_network("")), board(board), config(config)
+    {
+        const auto settings = config->settings();
+        seed_random(settings->no_random);
+        configure(*settings);
+    }
+
+    // Задаёт генератор случайных чисел: при NoRandom - постоянное зерно и повторяемые партии
+    void seed_random(const bool no_random)
+    {
+        rand_eng.seed(!no_random ? unsigned(time(0)) : 0);
+    }
+
+    // Применяет настройки бота (метод оценки, оптимизация, файлы параметров).
+    // Вызывается при создании и между ходами, если settings.json изменился
+    void configure(const Settings &settings)
+    {
+        scoring_mode = settings.scoring;
+        optimization = settings.optimization;
+        // Подобранные Tools/tune_eval.cpp параметры оценки; без файла - исходные значения
+        params = load_eval_params(project_path + settings.eval_params_file);
+        // Режим Network: веса из файла NetworkFile. Если файла нет или он повреждён, остаются веса
+        // по умолчанию, равные оценке NumberAndPotential, а причина пишется в log.txt
+        use_network = has_network && (scoring_mode == Scoring::Network);
+        network = Nnue(load_network(""));
+        if (use_network)
+        {
+            try
+            {
+                network = Nnue(load_network(project_path + settings.network_file));
+            }
+            catch (const exception &e)
+            {
+                auto fout = open_log();
+                fout << "Network: " << e.what() << ", using default weights\n";
+                fout.close();
+            }
+        }
+        eval_fingerprint = evaluation_fingerprint();
+        configured_version = settings.version;
+    }
+
+    // Подготовка к новой партии без пересоздания объекта: очищает историю партии, сортировку ходов
+    // и результаты поиска. Выделенная память (стеки ходов, история, аккумуляторы) остаётся,
+    // генератор случайных чисел и настройки не трогаются
+    void new_game()
     {
-        rand_eng = std::default_random_engine (
-            !((*config)("Bot", "NoRandom")) ? unsigned(time(0)) : 0);
-        scoring_mode = (*config)("Bot", "BotScoringType");
-        optimization = (*config)("Bot", "Optimization");
+        history.clear();
+        clear_ordering();
+        STATS(stats.clear());
+        stopped = false;
+        best_score = 0;
+        completed_depth = -1;
+        lines.clear();
+        pv.clear();
     }
 
+    // Ход бота для текущей доски: итеративное углубление до Max_depth
     vector<move_pos> find_best_turns(const bool color)
     {
-        // Сбрасываем данные
-        next_move.clear();
-        next_best_state.clear();
-        // Ищем первый лучший ход
-        find_first_best_turn(board->get_board(), color, -1, -1, 0);
+        return find_best_turns_iterative(board->get_board(), color, Max_depth);
+    }
+
+    // Поиск лучшего хода для произвольной позиции, без привязки к Board (инструменты, бенчмарки)
+    vector<move_pos> find_best_turns(const vector<vector<POS_T>> &mtx, const bool color)
+    {
+        clear_ordering();
+        start_search();
+        STATS(stats.clear());
+        return search_root(mtx, color, -INF, INF);
+    }
 
-        vector<move_pos> result;
-        int cur_state = 0;
+    // Итеративное углубление: поиск на глубинах 0..max_depth, пока не сработает остановка.
+    // Возвращает ход последней досчитанной глубины, после каждой из них вызывается on_iteration(depth).
+    // Если не досчитана ни одна глубина, возвращается лучший из досчитанных ходов или любой возможный
+    vector<move_pos> find_best_turns_iterative(const vector<vector<POS_T>> &mtx, const bool color, const int max_depth,
+                                               const function<void(int)> &on_iteration = nullptr)
+    {
+        vector<move_pos> best, best_pv;
+        int score = 0;
+        completed_depth = -1;
+        // Сортировка ходов накапливается между итерациями одного поиска
+        clear_ordering();
+        // Ограничения limits действуют на весь поиск, а не на одну итерацию, статистика - тоже
+        start_search();
+        STATS(stats.clear());
+        for (int depth = 0; depth <= max_depth; ++depth)
+        {
+            Max_depth = depth;
+            // Начиная со второй итерации корень ищется в окне вокруг предыдущей оценки
+            vector<move_pos> turns;
+            if (depth > 0 && optimization != Optimization::O0)
+            {
+                turns = find_best_turns_aspiration(mtx, color, score);
+            }
+            else
+            {
+                turns = search_root(mtx, color, -INF, INF);
+            }
+            if (stopped)
+            {
+                if (best.empty())
+                {
+                    best = turns;
+                    best_pv = pv;
+                    score = best_score;
+                }
+                break;
+            }
+            best = turns;
+            best_pv = pv;
+            score = best_score;
+            completed_depth = depth;
+            if (on_iteration)
+                on_iteration(depth);
+            // Ходов нет, углубляться некуда
+            if (turns.empty())
+                return best;
+        }
+        if (best.empty())
+        {
+            auto moves = find_full_turns(mtx, color);
+            if (!moves.empty())
+                best = best_pv = moves[0];
+        }
+        best_score = score;
+        pv = best_pv;
+        STATS(stats.pv = pv);
+        return best;
+    }
 
-        // Хотя бы один ход будет, поэтому do ... while
-        do
+    // Анализ нескольких линий: итеративное углубление, на каждой глубине лучшие count полных ходов корня
+    // с точными оценками, по убыванию оценки. После каждой досчитанной глубины вызывается
+    // on_iteration(depth), линии этой глубины - в lines. При count = 1 результат совпадает с обычным
+    // поиском без окон стремления
+    vector<Root_line> find_best_lines(const vector<vector<POS_T>> &mtx, const bool color, const int max_depth,
+                                      const size_t count, const function<void(int)> &on_iteration = nullptr)
+    {
+        completed_depth = -1;
+        clear_ordering();
+        start_search();
+        STATS(stats.clear());
+        lines.clear();
+        // Все ходы корня с оценками последней досчитанной глубины, лучшие в начале
+        vector<Root_line> moves;
+        auto root = mtx;
+        vector<Full_move> root_moves;
+        find_moves(color, root, root_moves);
+        for (const auto &root_move : root_moves)
+            moves.push_back({root_move, root_move.steps(), 0});
+        if (moves.empty())
+            return lines;
+        for (int depth = 0; depth <= max_depth; ++depth)
         {
-            // Записываем следующий успешный ход и состояние
-            result.push_back(next_move[cur_state]);
-            cur_state = next_best_state[cur_state];
-        } 
-        while (cur_state != -1 && next_move[cur_state].x != -1);
+            Max_depth = depth;
+            auto cur = moves;
+            // Недосчитанная глубина не меняет результат
+            if (!search_root_lines(mtx, color, max<size_t>(count, 1), cur))
+                break;
+            moves = move(cur);
+            lines.assign(moves.begin(), moves.begin() + min(max<size_t>(count, 1), moves.size()));
+            best_score = lines[0].score;
+            root_best = lines[0].move;
+            pv = lines[0].pv;
+            completed_depth = depth;
+            STATS(stats.pv = pv);
+            if (on_iteration)
+                on_iteration(depth);
+        }
+        // Не досчитана ни одна глубина: ходы без оценок
+        if (lines.empty())
+            lines.assign(moves.begin(), moves.begin() + min(max<size_t>(count, 1), moves.size()));
+        return lines;
+    }
 
-        return result;
+    // Все полные ходы стороны color по перемещениям: серия взятий одной шашкой записывается как один ход
+    vector<vector<move_pos>> find_full_turns(const vector<vector<POS_T>> &mtx, const bool color)
+    {
+        auto pos = mtx;
+        vector<Full_move> moves;
+        find_moves(color, pos, moves);
+        vector<vector<move_pos>> res;
+        for (const auto &move : moves)
+            res.push_back(move.steps());
+        return res;
     }
 
-private:
     // Возвращает новое состояние доски после выполнения хода
     vector<vector<POS_T>> make_turn(vector<vector<POS_T>> mtx, move_pos turn) const
     {
@@ -50,7 +257,7 @@ private:
         if (turn.xb != -1)
             mtx[turn.xb][turn.yb] = 0;
         // Превращает пешку в ферзя
-        if ((mtx[turn.x][turn.y] == 1 && turn.x2 == 0) || (mtx[turn.x][turn.y] == 2 && turn.x2 == 7))
+        if (mtx[turn.x][turn.y] <= 2 && turn.x2 == Rules::promotion_row(mtx[turn.x][turn.y]))
             mtx[turn.x][turn.y] += 2;
         // Перемещает фигуру
         mtx[turn.x2][turn.y2] = mtx[turn.x][turn.y];
@@ -59,175 +266,875 @@ private:
         return mtx;
     }
 
-    // возвращает оценку текущего положения на доске в виде double
-    double calc_score(const vector<vector<POS_T>> &mtx, const bool first_bot_color) const
+    // Состояние доски после полного хода: в русских шашках то же, что make_turn для каждого прыжка серии
+    vector<vector<POS_T>> make_move(vector<vector<POS_T>> mtx, const Full_move &move) const
+    {
+        const POS_T piece = mtx[move.x(0)][move.y(0)];
+        mtx[move.x(0)][move.y(0)] = 0;
+        for (int k = 0; move.captured && k < move.length; ++k)
+            mtx[move.beaten[k] / Rules::SIZE][move.beaten[k] % Rules::SIZE] = 0;
+        mtx[move.x(move.length)][move.y(move.length)] = move.final_piece(piece);
+        return mtx;
+    }
+
+    // Возвращает оценку позиции с точки зрения бота цвета first_bot_color:
+    // разница сил в сотых долях шашки. Пешка - 100, дамка - params.number_only_king (400).
+    // В режиме "NumberAndPotential" дамка - params.king (500) и пешка получает params.row (5)
+    // за каждую пройденную горизонталь.
+    // Если у одной из сторон не осталось шашек, возвращает WIN_SCORE или -WIN_SCORE
+    int calc_score(const vector<vector<POS_T>> &mtx, const bool first_bot_color) const
     {
-        // color - who is max player
-        // Переменные для подсчета пешек
-        double w = 0, wq = 0, b = 0, bq = 0;
+        if constexpr (has_network)
+        {
+            if (use_network)
+                return network_score(network.accumulator(mtx), first_bot_color);
+        }
+        // Переменные для подсчета пешек, дамок и продвижения пешек
+        int w = 0, wq = 0, b = 0, bq = 0, wp = 0, bp = 0;
         // Два вложенных цикла проходят по всем клеткам доски.
         // Если на текущей клетке находится белая пешка, увеличивается счетчик белых пешек.
         // Аналогично для черных пешек и ферзей.
-        // Если режим оценки "NumberAndPotential", дополнительно учитывается положение пешек на доске.
-        for (POS_T i = 0; i < 8; ++i)
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
         {
-            for (POS_T j = 0; j < 8; ++j)
+            for (POS_T j = 0; j < Rules::SIZE; ++j)
             {
                 w += (mtx[i][j] == 1);
                 wq += (mtx[i][j] == 3);
                 b += (mtx[i][j] == 2);
                 bq += (mtx[i][j] == 4);
-                if (scoring_mode == "NumberAndPotential")
-                {
-                    w += 0.05 * (mtx[i][j] == 1) * (7 - i);
-                    b += 0.05 * (mtx[i][j] == 2) * (i);
-                }
+                wp += (mtx[i][j] == 1) * (Rules::SIZE - 1 - i);
+                bp += (mtx[i][j] == 2) * i;
             }
         }
-        // Если бот играет черными, происходит обмен значений переменных,
-        // чтобы максимизирующий игрок всегда был белым.
+        // Если бот играет белыми, происходит обмен значений переменных,
+        // чтобы бот всегда был черным.
         if (!first_bot_color)
         {
             swap(b, w);
             swap(bq, wq);
+            swap(bp, wp);
         }
-        // Победа черного игрока
+        // Победа бота
         if (w + wq == 0)
-            return INF;
-        // победа белого игрока
+            return WIN_SCORE;
+        // Победа соперника
         if (b + bq == 0)
-            return 0;
+            return -WIN_SCORE;
+        // Если режим оценки "NumberAndPotential", дополнительно учитывается положение пешек на доске
+        const bool potential = (scoring_mode == Scoring::NumberAndPotential);
         // Коэффициент важности королевы
-        int q_coef = 4;
+        const int q_coef = potential ? params.king : params.number_only_king;
+        int score = (b - w) * 100 + (bq - wq) * q_coef;
+        if (potential)
+            score += (bp - wp) * params.row;
+        return score;
+    }
 
-        if (scoring_mode == "NumberAndPotential")
+    // Оценки calc_score позиций пакета (Game/Batch_eval.h) с точки зрения batch.color: без сети
+    // все позиции считаются вместе по маскам, сетью - по одной
+    void calc_scores(const Position_batch &batch, vector<int> &scores) const
+    {
+        static_assert(Rules::SIZE == 8, "position batches hold 8x8 boards");
+        scores.resize(batch.size());
+        if constexpr (has_network)
         {
-            q_coef = 5;
+            if (use_network)
+            {
+                for (size_t k = 0; k < batch.size(); ++k)
+                {
+                    const fen_position pos{batch.white[k], batch.black[k], batch.kings[k], bool(batch.color[k])};
+                    scores[k] = network_score(network.accumulator(to_mtx(pos)), batch.color[k]);
+                }
+                return;
+            }
         }
-        //вычисляется итоговая оценка как отношение сил черного и белого игрока
-        return (b + bq * q_coef) / (w + wq * q_coef);
+        const bool potential = (scoring_mode == Scoring::NumberAndPotential);
+        Material_weights weights;
+        weights.king = potential ? params.king : params.number_only_king;
+        weights.row = potential ? params.row : 0;
+        weights.win = WIN_SCORE;
+        material_scores(batch, weights, scores.data());
     }
 
-    double find_first_best_turn(vector<vector<POS_T>> mtx, const bool color, const POS_T x, const POS_T y, size_t state,
-                                double alpha = -1)
+  private:
+    // Обход в глубину продолжений серии взятий move прямо на доске mtx: прыжок делается на месте
+    // и откатывается после обхода. Каждая законченная серия попадает в res
+    void extend_captures(vector<vector<POS_T>> &mtx, Full_move &move, vector<Full_move> &res)
     {
-        // Обнуляем следующий ход и состояние
-        next_best_state.push_back(-1);
-        next_move.emplace_back(-1, -1, -1, -1);
-        // Считаем возможные ходы, если можно ходить
-        if (state != 0)
+        const POS_T x = move.x(move.length), y = move.y(move.length);
+        find_turns(x, y, mtx);
+        if (!have_beats || move.length == Full_move::MAX_JUMPS)
         {
-            find_turns(x, y, mtx);
+            res.push_back(move);
+            return;
         }
-        
-        // Делаем копии
-        auto cur_turns = turns;
-        bool cur_have_beats = have_beats;
+        const auto jumps = turns;
+        for (const auto &turn : jumps)
+        {
+            const POS_T piece = mtx[x][y], beaten = mtx[turn.xb][turn.yb];
+            // Взятая шашка снимается сразу или остаётся до конца хода помеченной (её нельзя бить второй раз)
+            mtx[turn.xb][turn.yb] = Rules::REMOVE_CAPTURED_AT_END ? CAPTURED : 0;
+            mtx[x][y] = 0;
+            // В русских шашках пешка, дошедшая до последней горизонтали, продолжает бить дамкой
+            const bool promote = Rules::PROMOTE_IN_CAPTURE && piece <= 2 && turn.x2 == Rules::promotion_row(piece);
+            mtx[turn.x2][turn.y2] = promote ? piece + 2 : piece;
+            move.add(turn);
+            extend_captures(mtx, move, res);
+            move.remove_last();
+            mtx[turn.x2][turn.y2] = 0;
+            mtx[x][y] = piece;
+            mtx[turn.xb][turn.yb] = beaten;
+        }
+    }
+
+    // Готовит историю и сеть к поиску из корня mtx
+    void prepare_root(const vector<vector<POS_T>> &mtx, const bool color)
+    {
+        // Если корень не последняя позиция партии (инструменты без истории), история начинается с корня
+        if (history.last_hash() != Zobrist::hash<Rules::SIZE>(mtx, color))
+        {
+            history.clear();
+            history.template push<Rules>(mtx, color);
+        }
+        if constexpr (has_network)
+        {
+            if (use_network)
+                network.refresh(mtx);
+        }
+    }
+
+    // Поиск из корня в окне (alpha, beta). Возвращает серию ходов лучшего хода
+    vector<move_pos> search_root(const vector<vector<POS_T>> &mtx, const bool color, const int alpha,
+                                 const int beta)
+    {
+        prepare_root(mtx, color);
+        const uint64_t nodes_before = searched_nodes;
+        {
+            STATS(Stats_timer timer(stats.total_ns));
+            // Ищем первый лучший ход
+            best_score = find_first_best_turn(mtx, color, alpha, beta);
+        }
+        if (trace && !stopped)
+            trace_root(mtx, color, alpha, beta, best_score, searched_nodes - nodes_before);
+
+        const auto line = pv_table.line(0);
+        pv = to_steps(line);
+        // Поиск прерван до того, как был досчитан хотя бы один ход
+        if (line.empty())
+            return {};
+        STATS(stats.pv = pv);
+        // Ход бота - первый ход варианта
+        root_best = line[0];
+        return line[0].steps();
+    }
 
-        // Если нельзя побить и ход закончен, то ходит следующий игрок
-        if (!cur_have_beats && state != 0)
+    // Поиск из корня для нескольких линий: moves - полные ходы корня в порядке предыдущей итерации.
+    // Пока не набрано count линий, ход ищется с полным окном. Дальше ход сначала проверяется нулевым окном
+    // на оценке count-й линии и пересчитывается, только если вытесняет её. Так весь перебор - один обход
+    // корня, ходы-убийцы и сортировка общие для всех линий. Оценки ходов вне первых count - верхние границы.
+    // Возвращает false, если поиск прерван; иначе moves отсортированы по убыванию оценки
+    bool search_root_lines(const vector<vector<POS_T>> &mtx, const bool color, const size_t count,
+                           vector<Root_line> &moves)
+    {
+        prepare_root(mtx, color);
+        STATS(Stats_timer timer(stats.total_ns));
+        STATS(stats.node(0));
+        const uint64_t root_nodes = searched_nodes;
+        // точные оценки досчитанных ходов
+        vector<int> exact;
+        for (size_t k = 0; k < moves.size(); ++k)
         {
-            return find_best_turns_rec(mtx, 1 - color, 0, alpha);
+            auto &line = moves[k];
+            const auto next_mtx = make_move(mtx, line.move);
+            network_push(mtx, line.move);
+            const uint64_t nodes_before = searched_nodes;
+            int score, alpha = -INF, beta = INF, searches = 1;
+            if (exact.size() < count)
+            {
+                score = find_best_turns_rec(next_mtx, !color, 0, alpha, beta);
+            }
+            else
+            {
+                // оценка count-й линии
+                nth_element(exact.begin(), exact.begin() + (count - 1), exact.end(), greater<int>());
+                const int bound = exact[count - 1];
+                alpha = bound;
+                beta = bound + 1;
+                score = find_best_turns_rec(next_mtx, !color, 0, alpha, beta);
+                if (score > bound && !stopped)
+                {
+                    beta = INF;
+                    ++searches;
+                    score = find_best_turns_rec(next_mtx, !color, 0, alpha, beta);
+                }
+            }
+            network_pop();
+            if (stopped)
+                return false;
+            if (trace && trace->max_ply >= 1)
+                trace_move(next_mtx, !color, line.move, 1, k, alpha, beta, score, searched_nodes - nodes_before,
+                           searches > 1 ? TRACE_RESEARCH : 0, searches, Max_depth);
+            line.score = score;
+            line.pv = line.move.steps();
+            if (exact.size() < count || score > exact[count - 1])
+            {
+                exact.push_back(score);
+                // вариант после хода корня - в строке 1 таблицы
+                const auto rest = to_steps(pv_table.line(1));
+                line.pv.insert(line.pv.end(), rest.begin(), rest.end());
+            }
+        }
+        stable_sort(moves.begin(), moves.end(),
+                    [](const Root_line &a, const Root_line &b) { return a.score > b.score; });
+        if (trace)
+        {
+            trace_node = {uint8_t(min<size_t>(moves.size(), 254)), NO_CUTOFF};
+            trace_root(mtx, color, -INF, INF, moves.empty() ? -WIN_SCORE : moves[0].score, searched_nodes - root_nodes);
         }
+        return true;
+    }
 
+    // Поиск с окном стремления вокруг оценки предыдущей итерации.
+    // Если оценка выходит за окно, окно расширяется и поиск повторяется
+    vector<move_pos> find_best_turns_aspiration(const vector<vector<POS_T>> &mtx, const bool color,
+                                                const int prev_score)
+    {
+        // Выигрыш или проигрыш уже найден: окно не поможет
+        if (is_win_score(prev_score))
+            return search_root(mtx, color, -INF, INF);
+        int delta = aspiration_delta;
+        while (true)
+        {
+            const int alpha = max(prev_score - delta, -INF), beta = min(prev_score + delta, INF);
+            auto result = search_root(mtx, color, alpha, beta);
+            if (stopped || (best_score > alpha && best_score < beta))
+                return result;
+            // После нескольких неудач окно раскрывается полностью
+            if (delta > 1000)
+                return search_root(mtx, color, -INF, INF);
+            delta *= 4;
+        }
+    }
+
+    // Сбрасывает данные для сортировки ходов: ходы-убийцы и лучший ход корня
+    void clear_ordering()
+    {
+        killers.assign(SearchStats::MAX_PLY, Full_move());
+        root_best = Full_move();
+    }
+
+    // Корень: узел максимизирующего игрока, серия взятий - один ход.
+    // Первый ход ищется с полным окном, остальные - с нулевым окном (PVS)
+    // и пересчитываются, только если оказались лучше
+    int find_first_best_turn(vector<vector<POS_T>> mtx, const bool color, int alpha = -INF, const int beta = INF)
+    {
+        pv_table.clear(0);
+        STATS(stats.node(0));
+        if (trace)
+            trace_node = Trace_node();
+        if (should_stop())
+            return 0;
+        // Ходы корня, лучший ход предыдущей итерации проверяется первым
+        auto &moves = move_lists[0];
+        {
+            STATS(Stats_timer timer(stats.movegen_ns, stats.sample(++stats.movegens)));
+            find_moves(color, mtx, moves);
+        }
+        move_to_front(moves, root_best);
+
+        // У бота нет ходов в корне - проигрыш
+        if (moves.empty())
+            return -WIN_SCORE;
+
+        // При O0 отсечения отключены
+        const bool prune = (optimization != Optimization::O0);
         // Лучший счет
-        double best_score = -1;
+        int best_score = -INF;
+        // для записи дерева: перебранные ходы и ход отсечения
+        Trace_node node{0, NO_CUTOFF};
         // Перебираем возможные ходы
-        for (auto turn : cur_turns)
+        for (size_t k = 0; k < moves.size(); ++k)
         {
-            // Текущее состояние
-            size_t next_state = next_move.size();
-            double score;
-            // Если можно побить, то бьем и перемещаемся, игрок не меняется
-            if (cur_have_beats)
+            const auto &move = moves[k];
+            const auto next_mtx = make_move(mtx, move);
+            network_push(mtx, move);
+            const uint64_t nodes_before = searched_nodes;
+            // окно последнего поиска хода и число поисков (для записи дерева)
+            int last_alpha = alpha, last_beta = beta, searches = 0;
+            // Ход сделан, ходит следующий игрок
+            auto search = [&](const int a, const int b) {
+                last_alpha = a;
+                last_beta = b;
+                ++searches;
+                return find_best_turns_rec(next_mtx, 1 - color, 0, a, b);
+            };
+            int score;
+            if (k == 0 || !prune)
             {
-                score = find_first_best_turn(make_turn(mtx, turn), color, turn.x2, turn.y2, next_state, best_score);
+                score = search(alpha, beta);
             }
-            // Если бить некого, то ходит следующий игрок
             else
             {
-                score = find_best_turns_rec(make_turn(mtx, turn), 1 - color, 0, best_score);
+                score = search(alpha, alpha + 1);
+                if (score > alpha && score < beta && !stopped)
+                    score = search(alpha, beta);
             }
+            network_pop();
+            // Оценка прерванного поддерева недостоверна, берём лучший из досчитанных ходов
+            if (stopped)
+                break;
 
             // Выбираем первый оптимальный ход
-            if (score > best_score)
+            const bool improved = score > best_score;
+            if (improved)
             {
                 best_score = score;
-                next_best_state[state] = (cur_have_beats ? next_state : -1);
-                next_move[state] = turn;
+                pv_table.update(0, move);
+            }
+            alpha = max(alpha, score);
+            const bool cutoff = prune && alpha >= beta;
+            ++node.moves;
+            if (trace && trace->max_ply >= 1)
+            {
+                const uint8_t flags = (improved ? TRACE_BEST : 0) | (cutoff ? TRACE_CUTOFF : 0) |
+                                      (k > 0 && prune && last_beta - last_alpha > 1 ? TRACE_RESEARCH : 0);
+                trace_move(next_mtx, !color, move, 1, k, last_alpha, last_beta, score, searched_nodes - nodes_before,
+                           flags, searches, Max_depth);
+            }
+            if (cutoff)
+            {
+                STATS(stats.cutoff(k));
+                node.cutoff = uint8_t(k);
+                break;
             }
         }
 
+        if (trace)
+            trace_node = node;
         return best_score;
     }
 
-    double find_best_turns_rec(vector<vector<POS_T>> mtx, const bool color, const size_t depth, double alpha = -1, double beta = INF + 1, const POS_T x = -1, const POS_T y = -1)
+    // Минимакс с альфа-бета отсечением. На нечётной глубине ходит бот (максимизирует оценку),
+    // на чётной - соперник (минимизирует). Каждый ход после первого проверяется нулевым окном.
+    // Серия взятий - один ход, поэтому каждый узел - новая позиция, а depth + 1 - номер строки
+    // таблицы главного варианта и списка ходов.
+    // ext - число полуходов, на которое ветка продлена (или сокращена, если ext < 0) выборочным поиском O2
+    int find_best_turns_rec(vector<vector<POS_T>> mtx, const bool color, const size_t depth, int alpha = -INF,
+                            int beta = INF, int ext = 0)
     {
+        const int ply = int(depth) + 1;
+        // окно узла до перебора: по нему определяется граница оценки для таблицы перестановок
+        const int node_alpha = alpha, node_beta = beta;
+        pv_table.clear(ply);
+        STATS(stats.node(depth + 1));
+        if (trace)
+            trace_node = Trace_node();
+        if (should_stop())
+            return 0;
+        // Позиция добавляется в историю на время обхода узла.
+        // Повторение позиции или правило ходов дамками - ничья, поддерево не перебирается
+        history.template push<Rules>(mtx, color);
+        History_guard history_guard{&history};
+        if (history.is_search_draw())
+            return 0;
+        // Выборочный поиск: продления, сокращения и отсечение бесперспективных ходов
+        const bool selective = (optimization == Optimization::O2);
+        // Цвет бота не меняется по ходу поиска, он нужен для оценки позиции
+        const bool bot_color = (depth % 2 == color);
+        // Глубже таблиц главного варианта и списков ходов поиск не идёт
+        const bool ply_limit = (ply + 1 >= Pv_table<Full_move>::MAX_PLY);
+        auto &moves = move_lists[ply];
+        bool generated = false;
+        bool cur_have_beats = false;
         // Если достигли максимальной глубины поиска, возвращаем оценку позиции
-        if (depth == Max_depth) 
+        if (int(depth) >= Max_depth + ext || ply_limit)
         {
-            return calc_score(mtx, (depth % 2 == color));
+            // O2: позиция с обязательным взятием не оценивается статически, поиск продлевается на полуход
+            if (selective && ext < max_extension && !ply_limit)
+            {
+                STATS(Stats_timer timer(stats.movegen_ns, stats.sample(++stats.movegens)));
+                cur_have_beats = find_moves(color, mtx, moves);
+                generated = true;
+            }
+            if (!generated || !cur_have_beats)
+            {
+                STATS(Stats_timer timer(stats.eval_ns, stats.sample(++stats.evals)));
+                const int score = static_eval(mtx, bot_color);
+                // Выигрыш на листе засчитывается на этом полуходе
+                if (abs(score) == WIN_SCORE)
+                    return score > 0 ? WIN_SCORE - int(depth + 1) : int(depth + 1) - WIN_SCORE;
+                return score;
+            }
+            ++ext;
+            STATS(++stats.extensions);
         }
 
-        // Если указаны конкретные координаты, ищем ходы из этой позиции
-        if (x != -1 && y != -1)
+        const bool is_max = depth % 2;
+        // Оставшаяся глубина: 1 - ходы этого узла ведут в листья
+        const int remaining = Max_depth + ext - int(depth);
+        // Таблица перестановок (кроме O0): позиция уже искалась не мельче - в узле с нулевым окном оценка
+        // берётся из таблицы, если она точная или её граница даёт отсечение (в узлах главного варианта
+        // перебор идёт всегда, чтобы вариант был полным); лучший ход из таблицы проверяется первым
+        const bool use_tt = tt && optimization != Optimization::O0;
+        Tt_data tt_data;
+        const bool tt_hit = use_tt && tt->probe(history.last_hash(), tt_data);
+        if (tt_hit && tt_data.draft >= remaining && node_beta - node_alpha == 1)
         {
-            find_turns(x, y, mtx);
+            const int score = from_tt_score(tt_data.score, is_max, depth);
+            // граница с точки зрения бота: у соперника нижняя и верхняя меняются местами
+            const Tt_bound bound = (is_max || tt_data.bound == TT_EXACT) ? tt_data.bound : Tt_bound(tt_data.bound ^ 3);
+            if (bound == TT_EXACT || (bound == TT_LOWER && score >= beta) || (bound == TT_UPPER && score <= alpha))
+            {
+                STATS(++stats.tt_hits);
+                return score;
+            }
         }
-        // Иначе ищем ходы для данного цвета
-        else                    
+
+        if (!generated)
         {
-            find_turns(color, mtx);
+            STATS(Stats_timer timer(stats.movegen_ns, stats.sample(++stats.movegens)));
+            cur_have_beats = find_moves(color, mtx, moves);
         }
 
-        // Сохраняем текущие ходы и признак наличия ударов
-        auto curTurns = turns;
-        auto cur_have_beats = have_beats;
-
-        // Если нет ударов и это не первый ход, меняем очередь хода
-        if (!cur_have_beats && x != -1)
+        // Ход-убийца этой глубины (давший отсечение в соседней ветке) проверяется первым
+        if (depth < killers.size())
+            move_to_front(moves, killers[depth]);
+        if (tt_hit && tt_data.move)
         {
-            return find_best_turns_rec(mtx, 1 - color, depth + 1, alpha, beta, -1, -1);
+            for (size_t k = 1; k < moves.size(); ++k)
+            {
+                if (tt_move(moves[k]) == tt_data.move)
+                {
+                    rotate(moves.begin(), moves.begin() + k, moves.begin() + k + 1);
+                    break;
+                }
+            }
         }
 
-        // Если нет доступных ходов, то игрок проиграл
-        if (curTurns.empty()) 
+        // Если нет доступных ходов, то игрок проиграл. Чем дальше от корня, тем меньше выигрыш
+        if (moves.empty())
         {
-            return (depth % 2 ? 0 : INF);
+            return (depth % 2 ? int(depth + 1) - WIN_SCORE : WIN_SCORE - int(depth + 1));
         }
 
-        // Инициализация минимального и максимального значений оценок
-        double min_score = INF + 1;
-        double max_score = -1;
+        // При O0 отсечения отключены
+        const bool prune = (optimization != Optimization::O0);
+        // Статическая оценка для отсечения тихих ходов у листьев (считается при необходимости)
+        int static_score = 0;
+        bool have_static_score = false;
+        // Лучшая оценка для ходящего игрока
+        int best_score = is_max ? -INF : INF;
+        // для записи дерева: перебранные ходы и ход отсечения
+        Trace_node node{0, NO_CUTOFF};
+        // лучший ход узла для таблицы перестановок
+        uint32_t best_move = 0;
 
         // Перебор всех возможных ходов
-        for (auto turn : curTurns) 
+        for (size_t k = 0; k < moves.size(); ++k)
         {
-            double score = 0.0;
+            const auto &move = moves[k];
+            const POS_T piece = mtx[move.x(0)][move.y(0)];
+            // Пешка выходит на предпоследнюю горизонталь и угрожает превратиться в дамку
+            const bool promotion_threat =
+                !cur_have_beats && piece <= 2 && abs(move.x(1) - Rules::promotion_row(piece)) == 1;
+            if (selective && k > 0 && !cur_have_beats && !promotion_threat && remaining == 1)
+            {
+                // У листьев тихий ход почти не меняет оценку: если позиция безнадёжна
+                // относительно окна, такие ходы не перебираются
+                if (!have_static_score)
+                {
+                    STATS(++stats.evals);
+                    static_score = static_eval(mtx, bot_color);
+                    have_static_score = true;
+                }
+                if ((is_max && static_score + futility_margin <= alpha) ||
+                    (!is_max && static_score - futility_margin >= beta))
+                {
+                    STATS(++stats.pruned);
+                    continue;
+                }
+            }
+            const auto next_mtx = make_move(mtx, move);
+            network_push(mtx, move);
+            const uint64_t nodes_before = searched_nodes;
+            // окно и продление последнего поиска хода, число поисков (для записи дерева)
+            int last_alpha = alpha, last_beta = beta, last_ext = ext, searches = 0;
+            // child_ext - продление (или сокращение) для хода
+            auto search = [&](const int a, const int b, const int child_ext) {
+                last_alpha = a;
+                last_beta = b;
+                last_ext = child_ext;
+                ++searches;
+                return find_best_turns_rec(next_mtx, 1 - color, depth + 1, a, b, child_ext);
+            };
+            int child_ext = ext;
+            if (selective && promotion_threat && ext < max_extension)
+            {
+                ++child_ext;
+                STATS(++stats.extensions);
+            }
+            // Поздние тихие ходы сначала проверяются на меньшей глубине
+            const bool reduce = selective && !cur_have_beats && !promotion_threat && k >= lmr_min_moves && remaining >= 3;
+
+            int score;
+            if (k == 0 || !prune)
+            {
+                score = search(alpha, beta, child_ext);
+            }
+            // Нулевое окно: проверяем только, лучше ли ход уже найденного
+            else if (is_max)
+            {
+                const int null_beta = alpha + 1;
+                score = alpha + 1;
+                if (reduce)
+                {
+                    STATS(++stats.reductions);
+                    score = search(alpha, null_beta, child_ext - 1);
+                }
+                // Сокращённый поиск не опроверг ход: проверяем на полной глубине
+                if (score > alpha && !stopped)
+                    score = search(alpha, null_beta, child_ext);
+                if (score > alpha && score < beta && !stopped)
+                    score = search(alpha, beta, child_ext);
+            }
+            else
+            {
+                const int null_alpha = beta - 1;
+                score = beta - 1;
+                if (reduce)
+                {
+                    STATS(++stats.reductions);
+                    score = search(null_alpha, beta, child_ext - 1);
+                }
+                if (score < beta && !stopped)
+                    score = search(null_alpha, beta, child_ext);
+                if (score < beta && score > alpha && !stopped)
+                    score = search(alpha, beta, child_ext);
+            }
+            network_pop();
+            if (stopped)
+                return score;
 
-            // Продолжаем искать лучшие ходы для удара
-            if (cur_have_beats) 
+            // Обновляем лучшую оценку, главный вариант и границы окна
+            const bool improved = is_max ? score > alpha : score < beta;
+            if (is_max)
+            {
+                best_score = max(best_score, score);
+                if (improved)
+                {
+                    pv_table.update(ply, move);
+                    best_move = tt_move(move);
+                }
+                alpha = max(alpha, score);
+            }
+            else
             {
-                score = find_best_turns_rec(make_turn(mtx, turn), color, depth, alpha, beta, turn.x2, turn.y2);
+                best_score = min(best_score, score);
+                if (improved)
+                {
+                    pv_table.update(ply, move);
+                    best_move = tt_move(move);
+                }
+                beta = min(beta, score);
+            }
+            const bool cutoff = prune && alpha >= beta;
+            ++node.moves;
+            if (trace && ply < trace->max_ply)
+            {
+                const bool reduced = reduce && k > 0 && prune;
+                const uint8_t flags = (improved ? TRACE_BEST : 0) | (cutoff ? TRACE_CUTOFF : 0) |
+                                      (reduced ? TRACE_REDUCED : 0) | (reduced && searches > 1 ? TRACE_LMR_FAIL : 0) |
+                                      (k > 0 && prune && last_beta - last_alpha > 1 ? TRACE_RESEARCH : 0) |
+                                      (child_ext > ext ? TRACE_EXTENDED : 0);
+                trace_move(next_mtx, !color, move, ply + 1, k, last_alpha, last_beta, score,
+                           searched_nodes - nodes_before, flags, searches, Max_depth + last_ext - int(depth) - 1);
             }
-            // Если это не удар, то меняем очередь хода
-            else 
+            if (cutoff)
             {
-                score = find_best_turns_rec(make_turn(mtx, turn), 1 - color, depth + 1, alpha, beta);
+                STATS(stats.cutoff(k));
+                if (depth < killers.size())
+                    killers[depth] = move;
+                node.cutoff = uint8_t(min<size_t>(k, 254));
+                break;
             }
+        }
+
+        if (use_tt)
+            tt_store(best_score, node_alpha, node_beta, is_max, depth, remaining, best_move);
+        if (trace)
+            trace_node = node;
+        return best_score;
+    }
+
+    // Записывает итог узла в таблицу перестановок. Оценка и окно - с точки зрения бота.
+    // Оценка за пределами окна со стороны отброшенных ходов заменяется границей окна:
+    // ходы, отброшенные у листьев (O2), не искались, известно лишь, что они не лучше окна
+    void tt_store(int score, const int alpha, const int beta, const bool is_max, const size_t depth,
+                  const int remaining, const uint32_t move)
+    {
+        Tt_data data;
+        if (score <= alpha)
+        {
+            data.bound = is_max ? TT_UPPER : TT_LOWER;
+            score = is_max ? alpha : score;
+        }
+        else if (score >= beta)
+        {
+            data.bound = is_max ? TT_LOWER : TT_UPPER;
+            score = is_max ? score : beta;
+        }
+        else
+            data.bound = TT_EXACT;
+        data.score = to_tt_score(score, is_max, depth);
+        data.draft = int8_t(min(remaining, 127));
+        data.move = move;
+        tt->store(history.last_hash(), data);
+    }
+
+    // Оценка узла на глубине depth для таблицы: с точки зрения ходящей стороны, выигрыш - в полуходах
+    // от узла, а не от корня (позиция может встретиться на другой глубине или в другом поиске)
+    static int16_t to_tt_score(int score, const bool is_max, const size_t depth)
+    {
+        score = is_max ? score : -score;
+        if (is_win_score(score))
+            score += score > 0 ? int(depth) : -int(depth);
+        return int16_t(score);
+    }
+
+    static int from_tt_score(int score, const bool is_max, const size_t depth)
+    {
+        if (is_win_score(score))
+            score -= score > 0 ? int(depth) : -int(depth);
+        return is_max ? score : -score;
+    }
+
+    // Ход для таблицы: начальная и конечная клетки, число перемещений и свёртка маски взятых
+    static uint32_t tt_move(const Full_move &move)
+    {
+        uint64_t captured = uint64_t(move.captured);
+        captured ^= captured >> 32;
+        captured ^= captured >> 16;
+        captured ^= captured >> 8;
+        return uint32_t(move.path[0]) | uint32_t(move.path[move.length]) << 8 | uint32_t(move.length) << 16 |
+               uint32_t(uint8_t(captured)) << 24;
+    }
+
+    // Итог перебора узла для записи дерева: число перебранных ходов и номер хода отсечения
+    struct Trace_node
+    {
+        uint8_t moves = 0;
+        uint8_t cutoff = NO_CUTOFF;
+    };
+
+    // Записывает ход move узла (ply - полуходов от корня после хода) с итогом поиска его поддерева.
+    // Итог перебора узла после хода берётся из trace_node: его только что оставил поиск потомка
+    void trace_move(const vector<vector<POS_T>> &next_mtx, const bool next_color, const Full_move &move,
+                    const int ply, const size_t index, const int alpha, const int beta, const int score,
+                    const uint64_t nodes, const uint8_t flags, const int searches, const int remaining)
+    {
+        if (nodes < trace->min_nodes)
+            return;
+        Trace_record record;
+        record.hash = Zobrist::hash<Rules::SIZE>(next_mtx, next_color);
+        record.nodes = uint32_t(min<uint64_t>(nodes, UINT32_MAX));
+        record.alpha = int16_t(alpha);
+        record.beta = int16_t(beta);
+        record.score = int16_t(score);
+        record.from = move.path[0];
+        record.to = move.path[move.length];
+        record.jumps = move.is_capture() ? move.length : 0;
+        record.ply = uint8_t(min(ply, 255));
+        record.remaining = int8_t(max(-128, min(remaining, 127)));
+        record.index = uint8_t(min<size_t>(index, 255));
+        record.moves = trace_node.moves;
+        record.cutoff = trace_node.cutoff;
+        record.flags = flags;
+        record.searches = uint8_t(min(searches, 255));
+        trace->append(record);
+    }
 
-            // Обновляем минимум и максимум
-            min_score = min(min_score, score);
-            max_score = max(max_score, score);
+    // Записывает поиск корня целиком: окно, оценку и узлы итерации
+    void trace_root(const vector<vector<POS_T>> &mtx, const bool color, const int alpha, const int beta,
+                    const int score, const uint64_t nodes)
+    {
+        Trace_record record;
+        record.hash = Zobrist::hash<Rules::SIZE>(mtx, color);
+        record.nodes = uint32_t(min<uint64_t>(nodes, UINT32_MAX));
+        record.alpha = int16_t(alpha);
+        record.beta = int16_t(beta);
+        record.score = int16_t(score);
+        record.remaining = int8_t(min(Max_depth, 127));
+        record.moves = trace_node.moves;
+        record.cutoff = trace_node.cutoff;
+        trace->append(record);
+    }
 
-            return (depth % 2 ? max_score : min_score);
+    // Снимает позицию ветки со стека истории при выходе из узла
+    struct History_guard
+    {
+        Position_history *history;
+        ~History_guard()
+        {
+            if (history)
+                history->pop();
         }
+    };
 
-        // Возвращаем итоговый результат
-        return (depth % 2 ? max_score : min_score);
+    // Оценка сети с точки зрения бота цвета bot_color
+    int network_score(const Nnue_accumulator &acc, const bool bot_color) const
+    {
+        if (!acc.pieces[bot_color])
+            return -WIN_SCORE;
+        if (!acc.pieces[!bot_color])
+            return WIN_SCORE;
+        const int score = network.evaluate(acc);
+        return bot_color ? -score : score;
+    }
+
+    // Оценка позиции в поиске: сеть берёт аккумулятор, обновлённый по ходу ветки
+    int static_eval(const vector<vector<POS_T>> &mtx, const bool bot_color) const
+    {
+        if constexpr (has_network)
+        {
+            if (use_network)
+                return network_score(network.top(), bot_color);
+        }
+        return calc_score(mtx, bot_color);
+    }
+
+    // Аккумулятор сети для позиции после хода move и его снятие при возврате
+    void network_push(const vector<vector<POS_T>> &mtx, const Full_move &move)
+    {
+        if constexpr (has_network)
+        {
+            if (use_network)
+                network.push(mtx, move);
+        }
+    }
+    void network_pop()
+    {
+        if constexpr (has_network)
+        {
+            if (use_network)
+                network.pop();
+        }
+    }
+
+    // Взятая, но ещё не снятая шашка (правило REMOVE_CAPTURED_AT_END)
+    static bool is_captured(const POS_T piece)
+    {
+        return Rules::REMOVE_CAPTURED_AT_END && piece == CAPTURED;
+    }
+
+    // Переставляет ход move (если он есть среди moves) в начало списка
+    static void move_to_front(vector<Full_move> &moves, const Full_move &move)
+    {
+        for (size_t k = 1; k < moves.size(); ++k)
+        {
+            if (moves[k] == move)
+            {
+                rotate(moves.begin(), moves.begin() + k, moves.begin() + k + 1);
+                return;
+            }
+        }
+    }
+
+    // Проверяет, нужно ли прервать поиск. Вызывается в каждом узле,
+    // ограничения limits проверяются раз в limits.poll_interval узлов
+    bool should_stop()
+    {
+        ++searched_nodes;
+        if (!stopped && (searched_nodes & (limits.poll_interval - 1)) == 0 && limits.reached(searched_nodes))
+            stopped = true;
+        return stopped;
+    }
+
+    // Отпечаток текущей оценки: метод, параметры calc_score и, в режиме Network, веса сети
+    uint64_t evaluation_fingerprint() const
+    {
+        const int32_t values[] = {int32_t(scoring_mode), params.king, params.number_only_king, params.row,
+                                  int32_t(use_network)};
+        uint64_t hash = fnv1a_hash(values, sizeof(values));
+        if (use_network)
+        {
+            const Nnue_weights &weights = network.get_weights();
+            hash = fnv1a_hash(weights.hidden, sizeof(weights.hidden), hash);
+            hash = fnv1a_hash(weights.hidden_bias, sizeof(weights.hidden_bias), hash);
+            hash = fnv1a_hash(weights.psqt, sizeof(weights.psqt), hash);
+            hash = fnv1a_hash(weights.out, sizeof(weights.out), hash);
+            hash = fnv1a_hash(&weights.out_bias, sizeof(weights.out_bias), hash);
+        }
+        return hash;
+    }
+
+    // Начало поиска: счётчик узлов с нуля, флаг остановки снят, новое поколение таблицы перестановок
+    void start_search()
+    {
+        searched_nodes = 0;
+        stopped = false;
+        if (tt)
+            tt->new_search();
     }
 
 public:
+    // Все полные ходы стороны color в позиции mtx: обычные ходы или, если есть взятие, серии взятий целиком.
+    // Серии перебираются обходом в глубину по самой доске (mtx меняется и восстанавливается).
+    // Порядок ходов случайный, как у find_turns. Возвращает true, если ходы - взятия
+    bool find_moves(const bool color, vector<vector<POS_T>> &mtx, vector<Full_move> &res)
+    {
+        res.clear();
+        bool beats = false;
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
+        {
+            for (POS_T j = 0; j < Rules::SIZE; ++j)
+            {
+                if (!mtx[i][j] || mtx[i][j] % 2 == color)
+                    continue;
+                find_turns(i, j, mtx);
+                // Первое найденное взятие отменяет все обычные ходы
+                if (have_beats && !beats)
+                {
+                    beats = true;
+                    res.clear();
+                }
+                if (have_beats != beats)
+                    continue;
+                if (!have_beats)
+                {
+                    for (const auto &turn : turns)
+                        res.emplace_back(turn);
+                    continue;
+                }
+                Full_move move;
+                move.path[0] = uint8_t(i * Rules::SIZE + j);
+                extend_captures(mtx, move, res);
+            }
+        }
+        // Правило большинства: из серий взятий допустимы только самые длинные.
+        // Серии с одинаковыми началом, концом и взятыми шашками считаются одним ходом
+        if (Rules::MAX_CAPTURE && beats)
+        {
+            uint8_t longest = 0;
+            for (const auto &move : res)
+                longest = max(longest, move.length);
+            size_t kept = 0;
+            for (size_t k = 0; k < res.size(); ++k)
+            {
+                const auto &move = res[k];
+                bool keep = (move.length == longest);
+                for (size_t m = 0; keep && m < kept; ++m)
+                    keep = !(res[m].path[0] == move.path[0] && res[m].path[longest] == move.path[longest] &&
+                             res[m].captured == move.captured);
+                if (keep)
+                    res[kept++] = move;
+            }
+            res.resize(kept);
+        }
+        shuffle(res.begin(), res.end(), rand_eng);
+        have_beats = beats;
+        return beats;
+    }
+
     void find_turns(const bool color)
     {
         find_turns(color, board->get_board());
@@ -238,7 +1145,6 @@ public:
         find_turns(x, y, board->get_board());
     }
 
-private:
     // находит все возможные ходы для фигур определенного цвета
     // на шахматной доске, представленной матрицей mtx.
     void find_turns(const bool color, const vector<vector<POS_T>> &mtx)
@@ -248,9 +1154,9 @@ private:
         // Цикл проходят по всем клеткам доски.Если текущая клетка содержит фигуру противоположного цвета,
         // вызывается внутренняя функция find_turns, которая ищет доступные ходы для этой фигуры.
         // Если найден удар, то предыдущие ходы очищаются, так как сначала нужно рассмотреть все удары.
-        for (POS_T i = 0; i < 8; ++i)
+        for (POS_T i = 0; i < Rules::SIZE; ++i)
         {
-            for (POS_T j = 0; j < 8; ++j)
+            for (POS_T j = 0; j < Rules::SIZE; ++j)
             {
                 if (mtx[i][j] && mtx[i][j] % 2 != color)
                 {
@@ -275,64 +1181,58 @@ private:
 
     // находит все возможные ходы для конкретной фигуры,
     // стоящей на позиции (x, y) на шахматной доске mtx.
+    // Длины диагоналей до края доски берутся из таблицы Rules, проверок границ в циклах нет
     void find_turns(const POS_T x, const POS_T y, const vector<vector<POS_T>> &mtx)
     {
         turns.clear();
         have_beats = false;
         POS_T type = mtx[x][y];
+        const bool king = type > 2;
+        // Направление хода пешки: белые идут к горизонтали 0
+        const POS_T forward = (type % 2) ? -1 : 1;
         // check beats
         // В зависимости от типа фигуры (пешки или ферзи),
         // выполняются разные алгоритмы поиска возможных ходов.
-        switch (type)
+        for (int d = 0; d < 4; ++d)
         {
-        case 1:
-        case 2:
-            // check pieces
-            // Для каждой возможной клетки удара проверяется,
-            // находится ли она внутри доски, есть ли там фигура противника
-            // и нет ли между ними других фигур.
-            // Если условия выполнены, добавляется новый ход.
-            for (POS_T i = x - 2; i <= x + 2; i += 4)
+            const POS_T dx = Rules::DX[d], dy = Rules::DY[d];
+            const int len = Rules::ray_length(x, y, d);
+            if (!king || !Rules::FLYING_KINGS)
             {
-                for (POS_T j = y - 2; j <= y + 2; j += 4)
-                {
-                    if (i < 0 || i > 7 || j < 0 || j > 7)
-                        continue;
-                    POS_T xb = (x + i) / 2, yb = (y + j) / 2;
-                    if (mtx[i][j] || !mtx[xb][yb] || mtx[xb][yb] % 2 == type % 2)
-                        continue;
-                    turns.emplace_back(x, y, i, j, xb, yb);
-                }
+                // check pieces
+                // Для каждой возможной клетки удара проверяется,
+                // находится ли она внутри доски, есть ли там фигура противника
+                // и нет ли между ними других фигур.
+                // Если условия выполнены, добавляется новый ход.
+                if (len < 2 || (!king && !Rules::MEN_CAPTURE_BACKWARD && dx != forward))
+                    continue;
+                const POS_T i = x + 2 * dx, j = y + 2 * dy, xb = x + dx, yb = y + dy;
+                if (mtx[i][j] || !mtx[xb][yb] || mtx[xb][yb] % 2 == type % 2 || is_captured(mtx[xb][yb]))
+                    continue;
+                turns.emplace_back(x, y, i, j, xb, yb);
+                continue;
             }
-            break;
-        default:
             // check queens
-            // Ферзь может двигаться по диагонали, поэтому цикл проходит по восьми направлениям.
+            // Ферзь может двигаться по диагонали на любое расстояние.
             // Если встречается фигура противника, она добавляется к возможным ударам.
-            for (POS_T i = -1; i <= 1; i += 2)
+            POS_T xb = -1, yb = -1;
+            POS_T i2 = x, j2 = y;
+            for (int s = 0; s < len; ++s)
             {
-                for (POS_T j = -1; j <= 1; j += 2)
+                i2 += dx;
+                j2 += dy;
+                if (mtx[i2][j2])
                 {
-                    POS_T xb = -1, yb = -1;
-                    for (POS_T i2 = x + i, j2 = y + j; i2 != 8 && j2 != 8 && i2 != -1 && j2 != -1; i2 += i, j2 += j)
-                    {
-                        if (mtx[i2][j2])
-                        {
-                            if (mtx[i2][j2] % 2 == type % 2 || (mtx[i2][j2] % 2 != type % 2 && xb != -1))
-                            {
-                                break;
-                            }
-                            xb = i2;
-                            yb = j2;
-                        }
-                        if (xb != -1 && xb != i2)
-                        {
-                            turns.emplace_back(x, y, i2, j2, xb, yb);
-                        }
-                    }
+                    if (mtx[i2][j2] % 2 == type % 2 || xb != -1 || is_captured(mtx[i2][j2]))
+                        break;
+                    xb = i2;
+                    yb = j2;
+                }
+                if (xb != -1 && xb != i2)
+                {
+                    turns.emplace_back(x, y, i2, j2, xb, yb);
                 }
             }
-            break;
         }
         // check other turns
         // Если были найдены удары, устанавливается флаг и выполнение функции прекращается.
@@ -341,40 +1241,25 @@ private:
             have_beats = true;
             return;
         }
-        switch (type)
+        for (int d = 0; d < 4; ++d)
         {
-        case 1:
-        case 2:
+            const POS_T dx = Rules::DX[d], dy = Rules::DY[d];
             // check pieces
-            // Поиск обычных ходов для пешек
             // Пешка может ходить вперед на одну клетку, если эта клетка свободна
-            {
-                POS_T i = ((type % 2) ? x - 1 : x + 1);
-                for (POS_T j = y - 1; j <= y + 1; j += 2)
-                {
-                    if (i < 0 || i > 7 || j < 0 || j > 7 || mtx[i][j])
-                        continue;
-                    turns.emplace_back(x, y, i, j);
-                }
-                break;
-            }
-        default:
+            if (!king && dx != forward)
+                continue;
             // check queens
-            // Поиск обычных ходов для ферзей
-            // Ферзь может двигаться по любой прямой линии, пока не встретит другую фигуру.
-            for (POS_T i = -1; i <= 1; i += 2)
+            // Ферзь может двигаться по диагонали, пока не встретит другую фигуру
+            const int len = (king && Rules::FLYING_KINGS) ? Rules::ray_length(x, y, d) : min(1, Rules::ray_length(x, y, d));
+            POS_T i2 = x, j2 = y;
+            for (int s = 0; s < len; ++s)
             {
-                for (POS_T j = -1; j <= 1; j += 2)
-                {
-                    for (POS_T i2 = x + i, j2 = y + j; i2 != 8 && j2 != 8 && i2 != -1 && j2 != -1; i2 += i, j2 += j)
-                    {
-                        if (mtx[i2][j2])
-                            break;
-                        turns.emplace_back(x, y, i2, j2);
-                    }
-                }
+                i2 += dx;
+                j2 += dy;
+                if (mtx[i2][j2])
+                    break;
+                turns.emplace_back(x, y, i2, j2);
             }
-            break;
         }
     }
 
@@ -385,21 +1270,75 @@ private:
     bool have_beats;
     // Глубина поиска алгоритма
     int Max_depth;
+    // статистика последнего вызова find_best_turns
+    SearchStats stats;
+    // ограничения поиска: узлы, крайний срок, внешний флаг остановки
+    Search_limits limits;
+    // запись дерева поиска для разбора (Models/Search_trace.h), nullptr - не пишется.
+    // Файлом владеет вызывающий код
+    Search_trace *trace = nullptr;
+    // таблица перестановок (Models/Transposition_table.h), nullptr - без неё. Таблицей владеет
+    // вызывающий код, одну таблицу могут использовать несколько Logic в разных потоках
+    Transposition_table *tt = nullptr;
+    // число узлов последнего поиска (считается и без статистики)
+    uint64_t searched_nodes = 0;
+    // был ли последний поиск прерван
+    bool stopped = false;
+    // оценка лучшего хода последнего поиска
+    int best_score = 0;
+    // последняя досчитанная глубина find_best_turns_iterative или find_best_lines (-1 - ни одной)
+    int completed_depth = -1;
+    // линии последнего find_best_lines
+    vector<Root_line> lines;
+    // главный вариант последнего поиска: перемещения обеих сторон, серии взятий по прыжкам
+    vector<move_pos> pv;
+    // позиции партии перед каждым ходом (ведёт вызывающий код) и позиции текущей ветки поиска
+    Position_history history;
+    // версия настроек, применённых configure
+    uint64_t configured_version = 0;
+    // отпечаток оценки (метод, параметры, веса сети): результаты поиска с другим отпечатком
+    // в таблице перестановок или файле опыта посчитаны другой оценкой
+    uint64_t eval_fingerprint = 0;
+    // параметры оценки calc_score (читаются из EvalParamsFile, инструменты могут менять их напрямую)
+    Eval_params params;
 
   private:
     // генератор случайных чисел
     default_random_engine rand_eng;
     //определяет метод оценки позиции
-    // NumberAndPotential или NumberOnly
-    string scoring_mode;
+    // NumberAndPotential, NumberOnly или Network
+    Scoring scoring_mode;
+    // оценка сетью (режим Network) и её аккумуляторы вдоль текущей ветки; признаки сети - клетки 8x8
+    static constexpr bool has_network = is_same<Rules, Russian_rules>::value;
+    bool use_network = false;
+    Nnue network;
     //Параметр оптимизации O0, O1 или O2
-    string optimization;
-    //Содержит следующий лучший ход, выбранный алгоритмом
-    vector<move_pos> next_move;
-    // содержит информацию о лучшем состоянии после следующего хода
-    vector<int> next_best_state;
+    Optimization optimization;
+    // начальная полуширина окна стремления в корне
+    static constexpr int aspiration_delta = 50;
+    // O2: наибольшее продление ветки в полуходах
+    static constexpr int max_extension = 4;
+    // O2: номер хода, начиная с которого тихие ходы ищутся с сокращением
+    static constexpr size_t lmr_min_moves = 3;
+    // O2: запас оценки, при котором тихие ходы у листьев не перебираются
+    static constexpr int futility_margin = 60;
+    // метка взятой, но ещё не снятой шашки во время обхода серии взятий (REMOVE_CAPTURED_AT_END)
+    static constexpr POS_T CAPTURED = 5;
+    // главный вариант текущего поиска по строкам (память выделена один раз)
+    Pv_table<Full_move> pv_table;
+    // ходы-убийцы: последний ход, давший отсечение на каждой глубине
+    vector<Full_move> killers;
+    // итог перебора последнего законченного узла (ведётся, только пока пишется дерево)
+    Trace_node trace_node;
+    // лучший ход корня на предыдущей итерации
+    Full_move root_best;
+    // списки ходов узлов текущей ветки по номеру полухода от корня (память переиспользуется между узлами)
+    vector<vector<Full_move>> move_lists = vector<vector<Full_move>>(Pv_table<Full_move>::MAX_PLY);
     // Текущее состояние доски
     Board *board;
     // Указатель на настройки (settings.json)
     Config *config;
 };
+
+// Движок русских шашек 8x8
+using Logic = Basic_logic<Russian_rules>;
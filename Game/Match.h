@@ -0,0 +1,150 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Models/Fen.h"
+#include "../Models/Move.h"
+#include "Logic.h"
+
+/*
+Партия бот против бота без окна и SDL: для матчей между настройками движка,
+самоигры и сбора партий для обучения. Правила окончания те же, что в Game::play:
+сторона без ходов проигрывает, после max_turns ходов, троекратного повторения позиции
+или 15 ходов одними дамками - ничья.
+*/
+
+// Запись партии
+struct match_game
+{
+    // 0 - ничья, 1 - победа белых, 2 - победа черных (как в Game::play)
+    int result = 0;
+    // позиции перед каждым ходом, начиная со стартовой
+    vector<fen_position> positions;
+    // суммарное время обдумывания белых и черных в миллисекундах
+    double think_ms[2] = {0, 0};
+    // число ходов каждой стороны
+    int moves[2] = {0, 0};
+};
+
+// Играет партию из позиции start. bots[0] играет белыми, bots[1] - черными,
+// levels - глубина поиска каждой стороны (как WhiteBotLevel / BlackBotLevel)
+inline match_game play_match_game(Logic *bots[2], const int levels[2], const fen_position &start, const int max_turns)
+{
+    match_game game;
+    bots[0]->new_game();
+    bots[1]->new_game();
+    auto mtx = to_mtx(start);
+    bool color = start.color;
+    int turn_num = 0;
+    for (; turn_num < max_turns; ++turn_num)
+    {
+        game.positions.push_back(from_mtx(mtx, color));
+        // История партии нужна обоим ботам для распознавания повторений
+        bots[0]->history.resize(turn_num);
+        bots[0]->history.push(mtx, color);
+        if (bots[1] != bots[0])
+        {
+            bots[1]->history.resize(turn_num);
+            bots[1]->history.push(mtx, color);
+        }
+        if (bots[0]->history.is_game_draw())
+            break;
+        Logic *bot = bots[color];
+        const auto begin = chrono::steady_clock::now();
+        const auto turns = bot->find_best_turns_iterative(mtx, color, levels[color]);
+        game.think_ms[color] += chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+        // Нет ходов - сторона проиграла
+        if (turns.empty())
+        {
+            game.result = color ? 1 : 2;
+            return game;
+        }
+        ++game.moves[color];
+        for (const auto &turn : turns)
+            mtx = bot->make_turn(mtx, turn);
+        color = !color;
+    }
+    game.result = 0;
+    return game;
+}
+
+// Играет games партий самоигры в threads потоках, у каждого потока свои боты с настройками config.
+// Партия k начинается с позиции openings[k % openings.size()]. on_game(k, game) вызывается
+// по окончании каждой партии, вызовы не пересекаются по времени
+inline void play_self_play(Config *config, const int level, const vector<fen_position> &openings, const int games,
+                           const unsigned threads, const function<void(int, const match_game &)> &on_game)
+{
+    const int max_turns = config->settings()->max_num_turns;
+    atomic<int> next_game{0};
+    mutex game_mutex;
+    auto worker = [&] {
+        Logic white(nullptr, config), black(nullptr, config);
+        Logic *bots[2] = {&white, &black};
+        const int levels[2] = {level, level};
+        int k;
+        while ((k = next_game++) < games)
+        {
+            const auto game = play_match_game(bots, levels, openings[k % openings.size()], max_turns);
+            lock_guard<mutex> lock(game_mutex);
+            on_game(k, game);
+        }
+    };
+    vector<thread> pool;
+    for (unsigned k = 0; k < threads; ++k)
+        pool.emplace_back(worker);
+    for (auto &th : pool)
+        th.join();
+}
+
+// Результат партии для белых: 1 - победа, 0.5 - ничья, 0 - поражение
+inline double white_result(const match_game &game)
+{
+    return game.result == 0 ? 0.5 : (game.result == 1 ? 1.0 : 0.0);
+}
+
+// Позиция из записанной партии и результат этой партии для белых
+struct position_record
+{
+    fen_position pos;
+    double result;
+};
+
+// Записывает позиции партии строками "<результат для белых> <FEN>" (формат файлов партий для обучения)
+inline void write_game_record(ostream &out, const match_game &game)
+{
+    const double result = white_result(game);
+    for (const auto &pos : game.positions)
+        out << result << ' ' << to_fen(pos) << '\n';
+}
+
+// Читает файл, записанный write_game_record. При ошибке выбрасывает исключение с номером строки
+inline vector<position_record> load_game_records(const string &path)
+{
+    ifstream fin(path);
+    if (!fin)
+        throw runtime_error("can't open game records " + path);
+    vector<position_record> res;
+    string line;
+    size_t line_num = 0;
+    while (getline(fin, line))
+    {
+        ++line_num;
+        if (line.empty() || line[0] == '#')
+            continue;
+        const size_t space = line.find(' ');
+        position_record record;
+        if (space == string::npos || !parse_fen(string_view(line).substr(space + 1), record.pos))
+            throw runtime_error("bad game record at " + path + ":" + to_string(line_num));
+        record.result = stod(line.substr(0, space));
+        res.push_back(record);
+    }
+    return res;
+}
@@ -0,0 +1,306 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+
+#include "../Models/Full_move.h"
+
+using namespace std;
+
+/*
+Обучаемая оценка позиции в стиле NNUE (режим BotScoringType = "Network").
+Признаки - пары (фигура, поле): 4 вида фигур на 32 полях, всего 128 признаков.
+Первый слой - аккумулятор: сумма строк весов включённых признаков. Ход меняет не больше
+трёх признаков (откуда, куда, взятая фигура), поэтому аккумулятор обновляется за
+несколько сложений int16 вместо пересчёта по всей доске.
+Оценка = линейная часть (цена фигуры на поле) + выход скрытого слоя:
+    sum(clamp(acc[i], 0, QA) * out[i]) / (QA * QB) + out_bias,
+скалярное произведение считается векторными командами (AVX2, SSE2 или без них).
+Оценка в сотых долях шашки с точки зрения белых.
+Веса без обучения повторяют оценку "NumberAndPotential"; обученные веса записывает Tools/train_eval.cpp.
+*/
+
+namespace nnue
+{
+// число признаков: 4 вида фигур * 32 поля
+const int FEATURES = 128;
+// размер скрытого слоя (кратен 16 для AVX2)
+const int HIDDEN = 32;
+// масштаб весов первого слоя: активация 1.0 соответствует QA
+const int QA = 127;
+// масштаб весов выходного слоя
+const int QB = 16;
+// заголовок файла весов
+const uint32_t MAGIC = 0x4e4e4b43; // "CKNN"
+const uint32_t VERSION = 1;
+
+// Номер признака фигуры piece (1..4) на клетке (x, y)
+inline int feature(const POS_T piece, const POS_T x, const POS_T y)
+{
+    return (piece - 1) * 32 + x * 4 + y / 2;
+}
+} // namespace nnue
+
+// Квантованные веса сети
+struct Nnue_weights
+{
+    // веса первого слоя по признакам
+    alignas(32) int16_t hidden[nnue::FEATURES][nnue::HIDDEN];
+    alignas(32) int16_t hidden_bias[nnue::HIDDEN];
+    // линейная часть: цена фигуры на поле в сотых долях шашки
+    int32_t psqt[nnue::FEATURES];
+    // выходной слой
+    alignas(32) int16_t out[nnue::HIDDEN];
+    int32_t out_bias;
+
+    // Веса, повторяющие оценку "NumberAndPotential": пешка 100 + 5 за пройденную горизонталь,
+    // дамка 500, скрытый слой выключен
+    Nnue_weights()
+    {
+        memset(hidden, 0, sizeof(hidden));
+        memset(hidden_bias, 0, sizeof(hidden_bias));
+        memset(out, 0, sizeof(out));
+        out_bias = 0;
+        for (POS_T x = 0; x < 8; ++x)
+        {
+            for (POS_T y = (x + 1) % 2; y < 8; y += 2)
+            {
+                psqt[nnue::feature(1, x, y)] = 100 + 5 * (7 - x);
+                psqt[nnue::feature(2, x, y)] = -(100 + 5 * x);
+                psqt[nnue::feature(3, x, y)] = 500;
+                psqt[nnue::feature(4, x, y)] = -500;
+            }
+        }
+    }
+
+    // Читает веса из файла. При ошибке выбрасывает исключение
+    void load(const string &path)
+    {
+        ifstream fin(path, ios::binary);
+        if (!fin)
+            throw runtime_error("can't open network file " + path);
+        uint32_t header[3];
+        fin.read((char *)header, sizeof(header));
+        if (!fin || header[0] != nnue::MAGIC || header[1] != nnue::VERSION || header[2] != nnue::HIDDEN)
+            throw runtime_error("bad network file header " + path);
+        fin.read((char *)hidden, sizeof(hidden));
+        fin.read((char *)hidden_bias, sizeof(hidden_bias));
+        fin.read((char *)psqt, sizeof(psqt));
+        fin.read((char *)out, sizeof(out));
+        fin.read((char *)&out_bias, sizeof(out_bias));
+        if (!fin)
+            throw runtime_error("network file is truncated " + path);
+    }
+
+    void save(const string &path) const
+    {
+        ofstream fout(path, ios::binary);
+        const uint32_t header[3] = {nnue::MAGIC, nnue::VERSION, nnue::HIDDEN};
+        fout.write((const char *)header, sizeof(header));
+        fout.write((const char *)hidden, sizeof(hidden));
+        fout.write((const char *)hidden_bias, sizeof(hidden_bias));
+        fout.write((const char *)psqt, sizeof(psqt));
+        fout.write((const char *)out, sizeof(out));
+        fout.write((const char *)&out_bias, sizeof(out_bias));
+        if (!fout)
+            throw runtime_error("can't write network file " + path);
+    }
+};
+
+// Загружает веса один раз на процесс: все экземпляры Logic (в том числе в разных потоках)
+// используют одну копию. Пустой путь - веса по умолчанию
+inline shared_ptr<const Nnue_weights> load_network(const string &path)
+{
+    static mutex cache_mutex;
+    static map<string, shared_ptr<const Nnue_weights>> cache;
+    lock_guard<mutex> lock(cache_mutex);
+    auto &weights = cache[path];
+    if (!weights)
+    {
+        auto loaded = make_shared<Nnue_weights>();
+        if (!path.empty())
+            loaded->load(path);
+        weights = loaded;
+    }
+    return weights;
+}
+
+// Первый слой для одной позиции
+struct Nnue_accumulator
+{
+    alignas(32) int16_t hidden[nnue::HIDDEN];
+    int32_t psqt;
+    // число фигур белых и черных: позиция без фигур одной из сторон проиграна
+    int pieces[2];
+};
+
+// Стек аккумуляторов вдоль текущей ветки поиска: push при ходе, pop при возврате
+class Nnue
+{
+  public:
+    explicit Nnue(shared_ptr<const Nnue_weights> weights) : weights(move(weights)), stack(1)
+    {
+    }
+
+    // Веса сети (для отпечатка оценки Logic::eval_fingerprint)
+    const Nnue_weights &get_weights() const
+    {
+        return *weights;
+    }
+
+    // Аккумулятор позиции, посчитанный по всей доске
+    Nnue_accumulator accumulator(const vector<vector<POS_T>> &mtx) const
+    {
+        Nnue_accumulator acc;
+        memcpy(acc.hidden, weights->hidden_bias, sizeof(acc.hidden));
+        acc.psqt = 0;
+        acc.pieces[0] = acc.pieces[1] = 0;
+        for (POS_T x = 0; x < 8; ++x)
+        {
+            for (POS_T y = 0; y < 8; ++y)
+            {
+                if (mtx[x][y])
+                {
+                    add_feature(acc, nnue::feature(mtx[x][y], x, y));
+                    ++acc.pieces[mtx[x][y] % 2 == 0];
+                }
+            }
+        }
+        return acc;
+    }
+
+    // Пересчитывает аккумулятор корня и очищает стек
+    void refresh(const vector<vector<POS_T>> &mtx)
+    {
+        stack.assign(1, accumulator(mtx));
+    }
+
+    // Аккумулятор позиции после полного хода move из позиции mtx (до хода), правила как в Logic::make_move
+    void push(const vector<vector<POS_T>> &mtx, const Full_move &move)
+    {
+        stack.push_back(stack.back());
+        Nnue_accumulator &acc = stack.back();
+        const POS_T piece = mtx[move.x(0)][move.y(0)];
+        sub_feature(acc, nnue::feature(piece, move.x(0), move.y(0)));
+        add_feature(acc, nnue::feature(move.final_piece(piece), move.x(move.length), move.y(move.length)));
+        for (int k = 0; move.captured && k < move.length; ++k)
+        {
+            const POS_T xb = move.beaten[k] >> 3, yb = move.beaten[k] & 7;
+            const POS_T beaten = mtx[xb][yb];
+            sub_feature(acc, nnue::feature(beaten, xb, yb));
+            --acc.pieces[beaten % 2 == 0];
+        }
+    }
+
+    void pop()
+    {
+        stack.pop_back();
+    }
+
+    // Аккумулятор текущей позиции ветки
+    const Nnue_accumulator &top() const
+    {
+        return stack.back();
+    }
+
+    // Оценка позиции с точки зрения белых
+    int evaluate(const Nnue_accumulator &acc) const
+    {
+        return acc.psqt + dot_hidden(acc) + weights->out_bias;
+    }
+
+  private:
+    void add_feature(Nnue_accumulator &acc, const int f) const
+    {
+        const int16_t *w = weights->hidden[f];
+#if defined(__AVX2__)
+        for (int i = 0; i < nnue::HIDDEN; i += 16)
+        {
+            __m256i *a = (__m256i *)(acc.hidden + i);
+            _mm256_store_si256(a, _mm256_add_epi16(_mm256_load_si256(a), _mm256_load_si256((const __m256i *)(w + i))));
+        }
+#elif defined(__SSE2__)
+        for (int i = 0; i < nnue::HIDDEN; i += 8)
+        {
+            __m128i *a = (__m128i *)(acc.hidden + i);
+            _mm_store_si128(a, _mm_add_epi16(_mm_load_si128(a), _mm_load_si128((const __m128i *)(w + i))));
+        }
+#else
+        for (int i = 0; i < nnue::HIDDEN; ++i)
+            acc.hidden[i] += w[i];
+#endif
+        acc.psqt += weights->psqt[f];
+    }
+
+    void sub_feature(Nnue_accumulator &acc, const int f) const
+    {
+        const int16_t *w = weights->hidden[f];
+#if defined(__AVX2__)
+        for (int i = 0; i < nnue::HIDDEN; i += 16)
+        {
+            __m256i *a = (__m256i *)(acc.hidden + i);
+            _mm256_store_si256(a, _mm256_sub_epi16(_mm256_load_si256(a), _mm256_load_si256((const __m256i *)(w + i))));
+        }
+#elif defined(__SSE2__)
+        for (int i = 0; i < nnue::HIDDEN; i += 8)
+        {
+            __m128i *a = (__m128i *)(acc.hidden + i);
+            _mm_store_si128(a, _mm_sub_epi16(_mm_load_si128(a), _mm_load_si128((const __m128i *)(w + i))));
+        }
+#else
+        for (int i = 0; i < nnue::HIDDEN; ++i)
+            acc.hidden[i] -= w[i];
+#endif
+        acc.psqt -= weights->psqt[f];
+    }
+
+    // sum(clamp(acc[i], 0, QA) * out[i]) / (QA * QB)
+    int dot_hidden(const Nnue_accumulator &acc) const
+    {
+        int32_t sum = 0;
+#if defined(__AVX2__)
+        const __m256i zero = _mm256_setzero_si256(), top = _mm256_set1_epi16(nnue::QA);
+        __m256i total = _mm256_setzero_si256();
+        for (int i = 0; i < nnue::HIDDEN; i += 16)
+        {
+            __m256i a = _mm256_load_si256((const __m256i *)(acc.hidden + i));
+            a = _mm256_min_epi16(_mm256_max_epi16(a, zero), top);
+            total = _mm256_add_epi32(total, _mm256_madd_epi16(a, _mm256_load_si256((const __m256i *)(weights->out + i))));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4e));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xb1));
+        sum = _mm_cvtsi128_si32(half);
+#elif defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128(), top = _mm_set1_epi16(nnue::QA);
+        __m128i total = _mm_setzero_si128();
+        for (int i = 0; i < nnue::HIDDEN; i += 8)
+        {
+            __m128i a = _mm_load_si128((const __m128i *)(acc.hidden + i));
+            a = _mm_min_epi16(_mm_max_epi16(a, zero), top);
+            total = _mm_add_epi32(total, _mm_madd_epi16(a, _mm_load_si128((const __m128i *)(weights->out + i))));
+        }
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0x4e));
+        total = _mm_add_epi32(total, _mm_shuffle_epi32(total, 0xb1));
+        sum = _mm_cvtsi128_si32(total);
+#else
+        for (int i = 0; i < nnue::HIDDEN; ++i)
+            sum += int32_t(min<int16_t>(max<int16_t>(acc.hidden[i], 0), nnue::QA)) * weights->out[i];
+#endif
+        return sum / (nnue::QA * nnue::QB);
+    }
+
+    shared_ptr<const Nnue_weights> weights;
+    vector<Nnue_accumulator> stack;
+};
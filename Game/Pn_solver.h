@@ -0,0 +1,319 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "../Models/Position_history.h"
+#include "../Models/Search_limits.h"
+#include "Logic.h"
+
+using namespace std;
+
+/*
+Решатель для доказательства выигрыша: поиск в глубину по числам доказательства и опровержения (df-pn).
+Узел, где ходит атакующая сторона, доказан, если доказан хотя бы один ход (OR-узел), узел соперника -
+если доказаны все ходы (AND-узел). Число доказательства pn - сколько листьев ещё нужно доказать,
+число опровержения dn - сколько опровергнуть. Поиск всегда идёт в самый дешёвый для доказательства
+или опровержения ход, а из поддерева возвращается, как только его числа превысят пороги,
+поэтому вместо фиксированной глубины перебирается самое узкое дерево форсированных ходов.
+Выигрыш - у соперника нет ходов (нет шашек или все заперты). Повторение позиции, правило ходов
+дамками и предел max_ply полуходов считаются неудачей атакующего, поэтому доказанный выигрыш
+не опирается на ничейные правила. Числа узлов хранятся в таблице ограниченного размера
+(корзины по 4 записи, вытесняется запись с наименьшим поддеревом); ключ учитывает число обратимых
+полуходов перед позицией (правило ходов дамками). Опровержение может быть неточным: узел, опровергнутый
+через повторение на одном пути, не пересчитывается на другом, поэтому No_win значит
+"выигрыш не найден", а Win - строгий результат.
+*/
+template <class Rules> class Basic_pn_solver
+{
+  public:
+    using Full_move = Basic_full_move<Rules>;
+
+    enum class Result
+    {
+        Win,
+        No_win,
+        Unknown
+    };
+
+    // logic - генератор ходов; memory_mb - размер таблицы (память выделяется при первом solve)
+    explicit Basic_pn_solver(Basic_logic<Rules> *logic, const size_t memory_mb = 64)
+        : logic(logic), memory_mb(memory_mb)
+    {
+    }
+
+    // Доказывает выигрыш стороны color, которая ходит в позиции mtx. history - позиции партии
+    // (последняя может быть самой mtx), по ним распознаются повторения. Таблица очищается
+    Result solve(const vector<vector<POS_T>> &mtx, const bool color, const Position_history &history = {})
+    {
+        if (table.empty())
+            table.resize(max<size_t>(1, memory_mb * 1024 * 1024 / sizeof(Entry) / BUCKET) * BUCKET);
+        fill(table.begin(), table.end(), Entry());
+        path = history;
+        if (path.last_hash() != Zobrist::hash<Rules::SIZE>(mtx, color))
+            path.template push<Rules>(mtx, color);
+        attacker = color;
+        nodes = 0;
+        stopped = false;
+        line.clear();
+        lists.resize(max_ply + 1);
+        boards.resize(max_ply + 1);
+
+        uint32_t pn = 1, dn = 1;
+        while (pn && dn && !stopped)
+            mid(mtx, color, 0, INF - 1, INF - 1, pn, dn);
+        if (pn == 0)
+        {
+            collect_line(mtx, color, history);
+            // Записи варианта вытеснены из таблицы: остаётся доказанный ход корня
+            if (line.empty())
+                line.push_back(root_move);
+            return Result::Win;
+        }
+        return dn == 0 ? Result::No_win : Result::Unknown;
+    }
+
+    // ограничения: узлы, крайний срок, внешний флаг остановки
+    Search_limits limits;
+    // наибольшая длина доказательства в полуходах от корня
+    int max_ply = 64;
+    // число узлов последнего solve
+    uint64_t nodes = 0;
+    // при Win: выигрывающий вариант (ходы обеих сторон, соперник сопротивляется дольше всего,
+    // насколько это известно из таблицы); не пустой, первый ход варианта гарантированно выигрывает
+    vector<Full_move> line;
+
+  private:
+    // числа доказательства и опровержения не больше INF, INF - доказано или опровергнуто
+    static constexpr uint32_t INF = 100000000;
+    static const size_t BUCKET = 4;
+
+    struct Entry
+    {
+        uint64_t key = 0;
+        uint32_t pn = 1;
+        uint32_t dn = 1;
+        // узлов, потраченных на поддерево (для вытеснения)
+        uint32_t work = 0;
+    };
+
+    // Ключ позиции на вершине path: хеш и число обратимых полуходов перед ней
+    uint64_t path_key() const
+    {
+        return (path.last_hash() ^ (uint64_t(path.reversible()) * 0x9E3779B97F4A7C15ull)) | 1;
+    }
+
+    const Entry *lookup(const uint64_t key) const
+    {
+        const size_t first = (key % (table.size() / BUCKET)) * BUCKET;
+        for (size_t k = first; k < first + BUCKET; ++k)
+            if (table[k].key == key)
+                return &table[k];
+        return nullptr;
+    }
+
+    void store(const uint64_t key, const uint32_t pn, const uint32_t dn, const uint64_t work)
+    {
+        const size_t first = (key % (table.size() / BUCKET)) * BUCKET;
+        Entry *target = &table[first];
+        for (size_t k = first; k < first + BUCKET; ++k)
+        {
+            if (table[k].key == key)
+            {
+                target = &table[k];
+                break;
+            }
+            if (table[k].work < target->work)
+                target = &table[k];
+        }
+        target->key = key;
+        target->pn = pn;
+        target->dn = dn;
+        target->work = uint32_t(min<uint64_t>(work, UINT32_MAX));
+    }
+
+    static uint32_t add_capped(const uint64_t a, const uint64_t b)
+    {
+        return uint32_t(min<uint64_t>(a + b, INF));
+    }
+
+    // Числа ребёнка k узла на полуходе ply: ничья на пути - неудача атакующего, иначе из таблицы
+    void child_numbers(const int ply, const size_t k, uint32_t &pn, uint32_t &dn) const
+    {
+        const Child &child = boards[ply][k];
+        pn = dn = 1;
+        if (child.draw)
+        {
+            pn = INF;
+            dn = 0;
+        }
+        else if (const Entry *entry = lookup(child.key))
+        {
+            pn = entry->pn;
+            dn = entry->dn;
+        }
+    }
+
+    // Поиск из узла mtx (ходит color) до порогов thpn и thdn; pn и dn - итоговые числа узла.
+    // Позиция узла уже на вершине path
+    uint64_t mid(const vector<vector<POS_T>> &mtx, const bool color, const int ply, const uint32_t thpn,
+                 const uint32_t thdn, uint32_t &pn, uint32_t &dn)
+    {
+        ++nodes;
+        if ((nodes & (limits.poll_interval - 1)) == 0 && limits.reached(nodes))
+            stopped = true;
+        const bool or_node = (color == attacker);
+        const uint64_t key = path_key();
+        // Ходы и позиции после них
+        auto &moves = lists[ply];
+        auto board = mtx;
+        logic->find_moves(color, board, moves);
+        if (moves.empty())
+        {
+            // Ходящий проиграл
+            pn = or_node ? INF : 0;
+            dn = or_node ? 0 : INF;
+            store(key, pn, dn, 1);
+            return 1;
+        }
+        if (ply >= max_ply)
+        {
+            pn = INF;
+            dn = 0;
+            return 1;
+        }
+        auto &children = boards[ply];
+        children.resize(moves.size());
+        for (size_t k = 0; k < moves.size(); ++k)
+        {
+            children[k].mtx = logic->make_move(mtx, moves[k]);
+            path.template push<Rules>(children[k].mtx, !color);
+            children[k].key = path_key();
+            children[k].draw = path.is_search_draw();
+            path.pop();
+        }
+
+        uint64_t work = 1;
+        while (true)
+        {
+            // Числа узла по детям и лучший ребёнок: у OR-узла - с наименьшим pn, у AND-узла - с наименьшим dn
+            uint64_t sum = 0;
+            uint32_t best = INF + 1, second = INF + 1, best_pn = 0, best_dn = 0;
+            size_t best_k = 0;
+            for (size_t k = 0; k < children.size(); ++k)
+            {
+                uint32_t cpn, cdn;
+                child_numbers(ply, k, cpn, cdn);
+                const uint32_t value = or_node ? cpn : cdn;
+                sum += or_node ? cdn : cpn;
+                if (value < best)
+                {
+                    second = best;
+                    best = value;
+                    best_k = k;
+                    best_pn = cpn;
+                    best_dn = cdn;
+                }
+                else if (value < second)
+                    second = value;
+            }
+            pn = or_node ? best : uint32_t(min<uint64_t>(sum, INF));
+            dn = or_node ? uint32_t(min<uint64_t>(sum, INF)) : best;
+            // Доказанный ход корня запоминается отдельно от таблицы
+            if (ply == 0 && pn == 0)
+                root_move = moves[best_k];
+            if (pn >= thpn || dn >= thdn || stopped)
+                break;
+
+            // Пороги ребёнка: его путь остаётся лучшим, пока он не хуже второго ребёнка
+            uint32_t child_thpn, child_thdn;
+            if (or_node)
+            {
+                child_thpn = min<uint32_t>(thpn, add_capped(second, 1));
+                child_thdn = uint32_t(min<uint64_t>(uint64_t(thdn) - dn + best_dn, INF));
+            }
+            else
+            {
+                child_thdn = min<uint32_t>(thdn, add_capped(second, 1));
+                child_thpn = uint32_t(min<uint64_t>(uint64_t(thpn) - pn + best_pn, INF));
+            }
+            const auto child_mtx = boards[ply][best_k].mtx;
+            path.template push<Rules>(child_mtx, !color);
+            uint32_t child_pn, child_dn;
+            work += mid(child_mtx, !color, ply + 1, child_thpn, child_thdn, child_pn, child_dn);
+            path.pop();
+            // Ребёнок на пределе глубины не записан в таблицу: запоминаем его опровержение здесь
+            if (child_dn == 0 && !lookup(boards[ply][best_k].key))
+                boards[ply][best_k].draw = true;
+        }
+        store(key, pn, dn, work);
+        return work;
+    }
+
+    // Выигрывающий вариант по таблице: у атакующего - доказанный ход, у соперника - ход
+    // с наибольшим поддеревом доказательства
+    void collect_line(vector<vector<POS_T>> mtx, bool color, const Position_history &history)
+    {
+        path = history;
+        if (path.last_hash() != Zobrist::hash<Rules::SIZE>(mtx, color))
+            path.template push<Rules>(mtx, color);
+        vector<Full_move> moves;
+        for (int ply = 0; ply < max_ply; ++ply)
+        {
+            auto board = mtx;
+            logic->find_moves(color, board, moves);
+            const Full_move *chosen = nullptr;
+            uint32_t chosen_work = 0;
+            for (const auto &move : moves)
+            {
+                path.template push<Rules>(logic->make_move(mtx, move), !color);
+                const Entry *entry = path.is_search_draw() ? nullptr : lookup(path_key());
+                path.pop();
+                if (!entry || entry->pn != 0)
+                    continue;
+                if (color == attacker)
+                {
+                    chosen = &move;
+                    break;
+                }
+                if (!chosen || entry->work > chosen_work)
+                {
+                    chosen = &move;
+                    chosen_work = entry->work;
+                }
+            }
+            // Конец партии или запись вытеснена из таблицы
+            if (!chosen)
+                return;
+            line.push_back(*chosen);
+            mtx = logic->make_move(mtx, *chosen);
+            color = !color;
+            path.template push<Rules>(mtx, color);
+        }
+    }
+
+    // Позиция после хода узла и её ключ; draw - ничья на пути (повторение, правило ходов дамками)
+    // или опровержение на пределе глубины
+    struct Child
+    {
+        vector<vector<POS_T>> mtx;
+        uint64_t key = 0;
+        bool draw = false;
+    };
+
+    Basic_logic<Rules> *logic;
+    size_t memory_mb;
+    // выигрывающий ход корня последнего solve
+    Full_move root_move;
+    vector<Entry> table;
+    // позиции партии и текущего пути поиска
+    Position_history path;
+    bool attacker = 0;
+    bool stopped = false;
+    // ходы и дети узлов текущего пути по полуходам (память переиспользуется)
+    vector<vector<Full_move>> lists;
+    vector<vector<Child>> boards;
+};
+
+// Решатель для русских шашек
+using Pn_solver = Basic_pn_solver<Russian_rules>;
@@ -0,0 +1,58 @@
+#pragma once
+#include <fstream>
+#include <nlohmann/json.hpp>
+#include <stdexcept>
+#include <string>
+using json = nlohmann::json;
+
+using namespace std;
+
+/*
+Параметры оценки Logic::calc_score в сотых долях шашки (пешка - 100).
+Значения по умолчанию - исходные константы оценки; подобранные Tools/tune_eval.cpp значения
+записываются в JSON-файл (EvalParamsFile в settings.json) и читаются Logic при создании:
+    {"King": 500, "NumberOnlyKing": 400, "Row": 5}
+*/
+struct Eval_params
+{
+    // цена дамки в режиме NumberAndPotential
+    int king = 500;
+    // цена дамки в режиме NumberOnly
+    int number_only_king = 400;
+    // прибавка пешке за каждую пройденную горизонталь в режиме NumberAndPotential
+    int row = 5;
+
+    json to_json() const
+    {
+        return json{{"King", king}, {"NumberOnlyKing", number_only_king}, {"Row", row}};
+    }
+
+    // Отсутствующие в json значения остаются прежними
+    void from_json(const json &j)
+    {
+        king = j.value("King", king);
+        number_only_king = j.value("NumberOnlyKing", number_only_king);
+        row = j.value("Row", row);
+    }
+
+    void save(const string &path) const
+    {
+        ofstream fout(path);
+        fout << to_json().dump(4) << endl;
+        if (!fout)
+            throw runtime_error("can't write eval params " + path);
+    }
+};
+
+// Читает параметры из файла. Если файла нет или он некорректен, возвращает значения по умолчанию
+inline Eval_params load_eval_params(const string &path)
+{
+    Eval_params params;
+    ifstream fin(path);
+    if (!fin)
+        return params;
+    const json j = json::parse(fin, nullptr, false);
+    if (j.is_object())
+        params.from_json(j);
+    return params;
+}
@@ -0,0 +1,229 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define EXPERIENCE_MMAP
+#else
+    #include <fstream>
+    #include <iterator>
+#endif
+
+#include "Transposition_table.h"
+
+using namespace std;
+
+/*
+Файл опыта бота: глубокие результаты поиска (хеш, глубина, оценка, граница, лучший ход) между запусками.
+После каждой партии в файл дописываются записи таблицы перестановок с глубиной от min_draft, при запуске
+файл читается через отображение в память и записи попадают в таблицу, поэтому позиции, уже посчитанные
+в прошлых партиях, ищутся быстрее. У записи есть номер партии, в которой она последний раз записана
+или встретилась позиция из неё; при превышении max_records вытесняются записи с самым старым номером
+(как LRU). Записи в файле упорядочены по этому номеру: при загрузке свежие пишутся в таблицу последними
+и вытесняют старые. Оценки зависят от оценки позиции, поэтому в заголовке записаны метод оценки и отпечаток
+оценки (Logic::eval_fingerprint: параметры и веса сети), и файл, посчитанный другой оценкой, не загружается.
+Файл: Experience_header, затем Experience_record подряд. Сохранение идёт во временный файл, который
+затем заменяет старый, поэтому оборванная запись не портит опыт.
+*/
+
+#pragma pack(push, 1)
+struct Experience_header
+{
+    char magic[4] = {'C', 'K', 'E', 'X'};
+    uint16_t version = 2;
+    uint16_t record_size = 24;
+    // размер доски, метод оценки (Scoring) и младшие 48 бит отпечатка оценки, с которыми посчитаны оценки
+    uint8_t board_size = 8;
+    uint8_t scoring = 0;
+    uint8_t eval[6] = {};
+    // число записей и номер последней сохранённой партии
+    uint64_t count = 0;
+    uint64_t games = 0;
+};
+
+struct Experience_record
+{
+    // хеш Zobrist позиции (ключ таблицы перестановок)
+    uint64_t key = 0;
+    // Tt_data::pack без поколения
+    uint64_t data = 0;
+    // номер партии последнего использования
+    uint32_t last_used = 0;
+    uint32_t reserved = 0;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(Experience_header) == 32 && sizeof(Experience_record) == 24, "experience records must be 24 bytes");
+
+class Experience_file
+{
+  public:
+    // наибольшее число записей файла (24 байта каждая)
+    size_t max_records = size_t(1) << 20;
+    // сохраняются записи с глубиной поиска не меньше min_draft
+    int min_draft = 4;
+
+    // Читает файл path и записывает его в таблицу tt. eval - отпечаток оценки. Возвращает число
+    // загруженных записей (0 - файла нет, он повреждён или посчитан для другой доски или оценки)
+    size_t load(const string &path, Transposition_table &tt, const int board_size, const int scoring,
+                const uint64_t eval)
+    {
+        size_t count = 0;
+        read(path, board_size, scoring, eval, [&](const Experience_record &record) {
+            tt.store(record.key, Tt_data::unpack(record.data));
+            ++count;
+        });
+        return count;
+    }
+
+    // Дописывает в файл path глубокие записи таблицы tt после партии. played - хеши позиций партии:
+    // записи этих позиций, уже бывшие в файле, тоже получают номер этой партии.
+    // Возвращает false, если файл не удалось записать
+    bool save(const string &path, const Transposition_table &tt, const vector<uint64_t> &played, const int board_size,
+              const int scoring, const uint64_t eval)
+    {
+        vector<Experience_record> records;
+        read(path, board_size, scoring, eval, [&](const Experience_record &record) { records.push_back(record); });
+        const uint32_t game = uint32_t(games + 1);
+        // ключ - номер записи в records
+        unordered_map<uint64_t, size_t> index;
+        index.reserve(records.size() * 2);
+        for (size_t k = 0; k < records.size(); ++k)
+            index[records[k].key] = k;
+        for (const uint64_t key : played)
+        {
+            const auto it = index.find(key);
+            if (it != index.end())
+                records[it->second].last_used = game;
+        }
+        tt.for_each([&](const uint64_t key, Tt_data data) {
+            if (data.draft < min_draft || data.bound == TT_NONE)
+                return;
+            data.generation = 0;
+            const uint64_t bits = data.pack();
+            const auto it = index.find(key);
+            if (it == index.end())
+            {
+                index[key] = records.size();
+                records.push_back(Experience_record{key, bits, game, 0});
+                return;
+            }
+            // Запись из файла, загруженная в таблицу и не изменённая поиском, сохраняет свой номер
+            Experience_record &record = records[it->second];
+            if (record.data == bits)
+                return;
+            // более мелкий поиск не заменяет глубокий результат, но отмечает его использование
+            if (Tt_data::unpack(record.data).draft <= data.draft)
+                record.data = bits;
+            record.last_used = game;
+        });
+        // Вытеснение: остаются max_records самых свежих, при равенстве - более глубокие
+        sort(records.begin(), records.end(), [](const Experience_record &a, const Experience_record &b) {
+            if (a.last_used != b.last_used)
+                return a.last_used < b.last_used;
+            return Tt_data::unpack(a.data).draft < Tt_data::unpack(b.data).draft;
+        });
+        if (records.size() > max_records)
+            records.erase(records.begin(), records.end() - max_records);
+
+        Experience_header header;
+        header.board_size = uint8_t(board_size);
+        header.scoring = uint8_t(scoring);
+        set_eval(header, eval);
+        header.count = records.size();
+        header.games = game;
+        const string temp = path + ".tmp";
+        FILE *out = fopen(temp.c_str(), "wb");
+        if (!out)
+            return false;
+        bool ok = fwrite(&header, sizeof(header), 1, out) == 1;
+        if (!records.empty())
+            ok = ok && fwrite(records.data(), sizeof(Experience_record), records.size(), out) == records.size();
+        ok = (fclose(out) == 0) && ok;
+        if (!ok || rename(temp.c_str(), path.c_str()) != 0)
+        {
+            remove(temp.c_str());
+            return false;
+        }
+        games = game;
+        return true;
+    }
+
+    // номер последней сохранённой партии (после load или save)
+    uint64_t games = 0;
+
+  private:
+    // Читает файл, отображённый в память, и вызывает fn(record) для каждой записи от старых к свежим.
+    // false - файла нет или он не подходит
+    template <class Fn>
+    bool read(const string &path, const int board_size, const int scoring, const uint64_t eval, Fn fn)
+    {
+#ifdef EXPERIENCE_MMAP
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(Experience_header))
+        {
+            ::close(fd);
+            return false;
+        }
+        const size_t size = size_t(st.st_size);
+        void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+            return false;
+        const bool ok = parse(static_cast<const char *>(mapped), size, board_size, scoring, eval, fn);
+        munmap(mapped, size);
+        return ok;
+#else
+        ifstream fin(path, ios::binary);
+        const string bytes((istreambuf_iterator<char>(fin)), istreambuf_iterator<char>());
+        return parse(bytes.data(), bytes.size(), board_size, scoring, eval, fn);
+#endif
+    }
+
+    // Записывает в заголовок младшие 48 бит отпечатка оценки
+    static void set_eval(Experience_header &header, const uint64_t eval)
+    {
+        for (int k = 0; k < 6; ++k)
+            header.eval[k] = uint8_t(eval >> (8 * k));
+    }
+
+    template <class Fn>
+    bool parse(const char *bytes, const size_t size, const int board_size, const int scoring, const uint64_t eval,
+               Fn fn)
+    {
+        if (size < sizeof(Experience_header))
+            return false;
+        Experience_header header;
+        memcpy(&header, bytes, sizeof(header));
+        Experience_header expected;
+        set_eval(expected, eval);
+        if (string(header.magic, 4) != "CKEX" || header.version != expected.version ||
+            header.record_size != sizeof(Experience_record) || header.board_size != board_size ||
+            header.scoring != scoring || memcmp(header.eval, expected.eval, sizeof(header.eval)) != 0 ||
+            header.count > (size - sizeof(header)) / sizeof(Experience_record))
+            return false;
+        // если записей больше max_records, самые старые (в начале файла) отбрасываются
+        const size_t count = min<size_t>(size_t(header.count), max_records);
+        const char *first = bytes + sizeof(header) + (header.count - count) * sizeof(Experience_record);
+        Experience_record record;
+        for (size_t k = 0; k < count; ++k)
+        {
+            memcpy(&record, first + k * sizeof(record), sizeof(record));
+            fn(record);
+        }
+        games = header.games;
+        return true;
+    }
+};
@@ -0,0 +1,258 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Move.h"
+
+using namespace std;
+
+/*
+Разбор и запись позиций в нотации FEN для шашек: "W:W21,22,K23:B1,2,3".
+Первая буква - чей ход (W - белые, B - черные), далее списки полей белых и черных,
+K перед номером обозначает дамку, допускаются диапазоны вида 1-12.
+Поля нумеруются от 1 до 32 по тёмным клеткам сверху вниз, слева направо:
+поле 1 - клетка (0, 1), поле 32 - клетка (7, 6). Черные стоят на 1-12, белые на 21-32.
+Разбор и запись не выделяют память, поэтому подходят для файлов с тысячами позиций.
+*/
+
+// Позиция в виде битовых масок: бит n - 1 соответствует полю n
+struct fen_position
+{
+    uint32_t white = 0;
+    uint32_t black = 0;
+    uint32_t kings = 0;
+    // чей ход: 0 - белые, 1 - черные (как color в Logic)
+    bool color = 0;
+
+    bool operator==(const fen_position &other) const
+    {
+        return white == other.white && black == other.black && kings == other.kings && color == other.color;
+    }
+};
+
+// Номер поля (1..32) в координаты клетки матрицы
+inline void square_to_cell(const int square, POS_T &x, POS_T &y)
+{
+    x = POS_T((square - 1) / 4);
+    y = POS_T(2 * ((square - 1) % 4) + (x % 2 == 0));
+}
+
+// Координаты тёмной клетки в номер поля (1..32)
+inline int cell_to_square(const POS_T x, const POS_T y)
+{
+    return x * 4 + y / 2 + 1;
+}
+
+// Разбирает FEN в pos. Возвращает false, если строка некорректна
+inline bool parse_fen(string_view text, fen_position &pos)
+{
+    pos = fen_position();
+    size_t k = 0;
+    auto skip_spaces = [&] {
+        while (k < text.size() && (text[k] == ' ' || text[k] == '\t' || text[k] == '\r' || text[k] == '"'))
+            ++k;
+    };
+    auto read_number = [&](int &value) {
+        skip_spaces();
+        if (k >= text.size() || text[k] < '0' || text[k] > '9')
+            return false;
+        value = 0;
+        while (k < text.size() && text[k] >= '0' && text[k] <= '9' && value <= 32)
+            value = value * 10 + (text[k++] - '0');
+        return value >= 1 && value <= 32;
+    };
+
+    skip_spaces();
+    if (k >= text.size() || (text[k] != 'W' && text[k] != 'B'))
+        return false;
+    pos.color = (text[k++] == 'B');
+
+    // Два раздела: ":W..." и ":B..." в любом порядке
+    for (int section = 0; section < 2; ++section)
+    {
+        skip_spaces();
+        if (k >= text.size() || text[k] != ':')
+            return false;
+        ++k;
+        skip_spaces();
+        if (k >= text.size() || (text[k] != 'W' && text[k] != 'B'))
+            return false;
+        uint32_t &side = (text[k++] == 'W' ? pos.white : pos.black);
+        skip_spaces();
+        // Раздел может быть пустым, если фигур этого цвета нет
+        while (k < text.size() && text[k] != ':' && text[k] != '.')
+        {
+            bool king = false;
+            if (text[k] == 'K')
+            {
+                king = true;
+                ++k;
+            }
+            int from, to;
+            if (!read_number(from))
+                return false;
+            to = from;
+            skip_spaces();
+            if (k < text.size() && text[k] == '-')
+            {
+                ++k;
+                if (!read_number(to) || to < from)
+                    return false;
+            }
+            for (int square = from; square <= to; ++square)
+            {
+                const uint32_t bit = uint32_t(1) << (square - 1);
+                side |= bit;
+                if (king)
+                    pos.kings |= bit;
+            }
+            skip_spaces();
+            if (k < text.size() && text[k] == ',')
+            {
+                ++k;
+                skip_spaces();
+            }
+        }
+    }
+    if (k < text.size() && text[k] == '.')
+        ++k;
+    skip_spaces();
+    // Одно поле не может быть занято обоими цветами
+    return k == text.size() && !(pos.white & pos.black);
+}
+
+// Записывает pos в buf (без завершающего нуля). Возвращает длину записи или 0, если буфер мал.
+// Для 24 фигур достаточно 128 байт
+inline size_t write_fen(const fen_position &pos, char *buf, const size_t size)
+{
+    size_t k = 0;
+    auto put = [&](const char c) {
+        if (k < size)
+            buf[k] = c;
+        ++k;
+    };
+    put(pos.color ? 'B' : 'W');
+    for (int section = 0; section < 2; ++section)
+    {
+        const uint32_t side = (section == 0 ? pos.white : pos.black);
+        put(':');
+        put(section == 0 ? 'W' : 'B');
+        bool first = true;
+        for (int square = 1; square <= 32; ++square)
+        {
+            const uint32_t bit = uint32_t(1) << (square - 1);
+            if (!(side & bit))
+                continue;
+            if (!first)
+                put(',');
+            first = false;
+            if (pos.kings & bit)
+                put('K');
+            if (square >= 10)
+                put(char('0' + square / 10));
+            put(char('0' + square % 10));
+        }
+    }
+    return k <= size ? k : 0;
+}
+
+inline string to_fen(const fen_position &pos)
+{
+    char buf[128];
+    return string(buf, write_fen(pos, buf, sizeof(buf)));
+}
+
+// Запись хода (серии перемещений одной шашки) номерами полей: "11-15", "18x27x20"
+inline string move_to_string(const vector<move_pos> &turns)
+{
+    if (turns.empty())
+        return "0000";
+    string res = to_string(cell_to_square(turns[0].x, turns[0].y));
+    for (const auto &turn : turns)
+    {
+        res += (turn.xb != -1 ? 'x' : '-');
+        res += to_string(cell_to_square(turn.x2, turn.y2));
+    }
+    return res;
+}
+
+// Запись варианта: полные ходы через пробел, "11-15 22-18 15x22"
+inline string line_to_string(const vector<move_pos> &line)
+{
+    if (line.empty())
+        return "0000";
+    string res;
+    for (size_t k = 0; k < line.size();)
+    {
+        const size_t len = full_move_length(line, k);
+        if (!res.empty())
+            res += ' ';
+        res += move_to_string(vector<move_pos>(line.begin() + k, line.begin() + k + len));
+        k += len;
+    }
+    return res;
+}
+
+// Переводит позицию в матрицу доски (1 - белая, 2 - черная, 3 - белая дамка, 4 - черная дамка)
+inline vector<vector<POS_T>> to_mtx(const fen_position &pos)
+{
+    vector<vector<POS_T>> mtx(8, vector<POS_T>(8, 0));
+    for (int square = 1; square <= 32; ++square)
+    {
+        const uint32_t bit = uint32_t(1) << (square - 1);
+        if (!((pos.white | pos.black) & bit))
+            continue;
+        POS_T x, y;
+        square_to_cell(square, x, y);
+        mtx[x][y] = POS_T((pos.white & bit) ? 1 : 2) + ((pos.kings & bit) ? 2 : 0);
+    }
+    return mtx;
+}
+
+// Переводит матрицу доски и цвет ходящего в позицию
+inline fen_position from_mtx(const vector<vector<POS_T>> &mtx, const bool color)
+{
+    fen_position pos;
+    pos.color = color;
+    for (POS_T i = 0; i < 8; ++i)
+    {
+        for (POS_T j = 0; j < 8; ++j)
+        {
+            if (!mtx[i][j] || (i + j) % 2 == 0)
+                continue;
+            const uint32_t bit = uint32_t(1) << (cell_to_square(i, j) - 1);
+            (mtx[i][j] % 2 ? pos.white : pos.black) |= bit;
+            if (mtx[i][j] > 2)
+                pos.kings |= bit;
+        }
+    }
+    return pos;
+}
+
+// Читает файл с позициями, по одной FEN в строке. Пустые строки и строки с '#' пропускаются.
+// При ошибке в строке выбрасывает исключение с номером строки
+inline vector<fen_position> load_fen_file(const string &path)
+{
+    ifstream fin(path);
+    if (!fin)
+        throw runtime_error("can't open FEN file " + path);
+    vector<fen_position> res;
+    string line;
+    size_t line_num = 0;
+    while (getline(fin, line))
+    {
+        ++line_num;
+        const size_t begin = line.find_first_not_of(" \t\r");
+        if (begin == string::npos || line[begin] == '#')
+            continue;
+        fen_position pos;
+        if (!parse_fen(string_view(line).substr(begin), pos))
+            throw runtime_error("bad FEN at " + path + ":" + to_string(line_num));
+        res.push_back(pos);
+    }
+    return res;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Move.h"
+#include "Rules.h"
+
+using namespace std;
+
+/*
+Полный ход: обычный ход или вся серия взятий одной шашкой, упакованная в одну запись.
+Хранятся клетки пути (x * SIZE + y, от начальной до конечной), взятые шашки по порядку прыжков
+и маска взятых тёмных клеток (ширина маски - из правил: 32 бита для 8x8, 64 для 10x10).
+В русских шашках движка взятая шашка снимается сразу после прыжка, и дамка может пройти через клетку
+уже взятой шашки, поэтому для разбора на прыжки нужен порядок взятий.
+*/
+template <class Rules> struct Basic_full_move
+{
+    // у соперника не больше PIECES шашек, длиннее серия не бывает
+    static const int MAX_JUMPS = Rules::PIECES;
+    using mask_t = typename Rules::mask_t;
+
+    // маска взятых клеток (бит Rules::square)
+    mask_t captured = 0;
+    // клетки пути: length + 1 штук
+    uint8_t path[MAX_JUMPS + 1] = {};
+    // клетки взятых шашек по порядку прыжков
+    uint8_t beaten[MAX_JUMPS] = {};
+    // число перемещений (1 - обычный ход)
+    uint8_t length = 0;
+
+    Basic_full_move() = default;
+
+    // Обычный ход
+    explicit Basic_full_move(const move_pos &turn)
+    {
+        path[0] = uint8_t(turn.x * Rules::SIZE + turn.y);
+        add(turn);
+    }
+
+    // Добавляет прыжок turn в конец серии
+    void add(const move_pos &turn)
+    {
+        path[++length] = uint8_t(turn.x2 * Rules::SIZE + turn.y2);
+        if (turn.xb != -1)
+        {
+            beaten[length - 1] = uint8_t(turn.xb * Rules::SIZE + turn.yb);
+            captured |= mask_t(1) << Rules::square(turn.xb, turn.yb);
+        }
+    }
+
+    // Убирает последний прыжок серии
+    void remove_last()
+    {
+        --length;
+        if (captured)
+            captured &= ~(mask_t(1) << Rules::square(beaten[length] / Rules::SIZE, beaten[length] % Rules::SIZE));
+    }
+
+    bool is_capture() const
+    {
+        return captured != 0;
+    }
+
+    // Клетка k пути (0 - начальная, length - конечная)
+    POS_T x(const int k) const
+    {
+        return POS_T(path[k] / Rules::SIZE);
+    }
+    POS_T y(const int k) const
+    {
+        return POS_T(path[k] % Rules::SIZE);
+    }
+
+    // Фигура после хода. Пешка становится дамкой на последней горизонтали:
+    // в русских шашках - на любом прыжке, в международных - только в конце хода
+    POS_T final_piece(const POS_T piece) const
+    {
+        if (piece > 2)
+            return piece;
+        const POS_T last_row = Rules::promotion_row(piece);
+        if (!Rules::PROMOTE_IN_CAPTURE)
+            return x(length) == last_row ? piece + 2 : piece;
+        for (int k = 1; k <= length; ++k)
+            if (x(k) == last_row)
+                return piece + 2;
+        return piece;
+    }
+
+    // Перемещение k в виде move_pos
+    move_pos step(const int k) const
+    {
+        if (!captured)
+            return move_pos(x(k), y(k), x(k + 1), y(k + 1));
+        return move_pos(x(k), y(k), x(k + 1), y(k + 1), POS_T(beaten[k] / Rules::SIZE), POS_T(beaten[k] % Rules::SIZE));
+    }
+
+    // Ход по перемещениям (как его показывает доска и записывают протоколы)
+    vector<move_pos> steps() const
+    {
+        vector<move_pos> res;
+        res.reserve(length);
+        for (int k = 0; k < length; ++k)
+            res.push_back(step(k));
+        return res;
+    }
+
+    bool operator==(const Basic_full_move &other) const
+    {
+        if (length != other.length || captured != other.captured)
+            return false;
+        for (int k = 0; k <= length; ++k)
+            if (path[k] != other.path[k])
+                return false;
+        return true;
+    }
+    bool operator!=(const Basic_full_move &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+// Полный ход русских шашек (доска, сеть, протоколы)
+using Full_move = Basic_full_move<Russian_rules>;
+
+// Вариант из полных ходов по перемещениям
+template <class Rules> vector<move_pos> to_steps(const vector<Basic_full_move<Rules>> &line)
+{
+    vector<move_pos> res;
+    for (const auto &move : line)
+        for (int k = 0; k < move.length; ++k)
+            res.push_back(move.step(k));
+    return res;
+}
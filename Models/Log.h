@@ -0,0 +1,20 @@
+#pragma once
+#include <atomic>
+#include <fstream>
+#include <string>
+
+#include "Project_path.h"
+
+using namespace std;
+
+/*
+Журнал игры log.txt: время ходов и партий, время запуска, ошибки SDL и настроек.
+Первая запись за запуск начинает файл заново, следующие дописываются в конец,
+поэтому запуск игры не трогает диск, пока писать нечего.
+*/
+inline ofstream open_log()
+{
+    static atomic<bool> started{false};
+    const bool first = !started.exchange(true);
+    return ofstream(project_path + "log.txt", first ? ios_base::trunc : ios_base::app);
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdlib.h>
+#include <vector>
 
 typedef int8_t POS_T;
 
@@ -26,3 +27,14 @@ struct move_pos
         return !(*this == other);
     }
 };
+
+// Число перемещений полного хода, начинающегося с line[from]: серия взятий одной шашкой - один ход.
+// Следующий ход соперника не может начаться с поля, на котором стоит только что ходившая шашка
+inline size_t full_move_length(const std::vector<move_pos> &line, const size_t from = 0)
+{
+    size_t k = from + 1;
+    while (k < line.size() && line[k - 1].xb != -1 && line[k].xb != -1 && line[k].x == line[k - 1].x2 &&
+           line[k].y == line[k - 1].y2)
+        ++k;
+    return k - from;
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include "Move.h"
+#include "Rules.h"
+#include "Zobrist.h"
+
+using namespace std;
+
+/*
+Стек позиций партии и текущей ветки поиска для распознавания ничьих.
+Для каждой позиции (перед ходом стороны) хранится хеш и число обратимых полуходов подряд
+перед ней. Обратимый полуход - ход дамкой без взятия: пешки не двигались и число фигур
+не изменилось. Повторение позиции возможно только внутри серии обратимых полуходов,
+поэтому поиск повторений просматривает лишь её.
+Правило ходов дамками: если обе стороны подряд ходили только дамками без взятий
+(15 ходов в русских шашках, 25 в международных - Rules::KING_MOVES_DRAW), партия заканчивается вничью.
+*/
+class Position_history
+{
+  public:
+    void clear()
+    {
+        entries.clear();
+    }
+
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+    // Хеш последней позиции
+    uint64_t last_hash() const
+    {
+        return entries.empty() ? 0 : entries.back().hash;
+    }
+
+    // Число обратимых полуходов подряд перед последней позицией
+    int reversible() const
+    {
+        return entries.empty() ? 0 : entries.back().reversible;
+    }
+
+    // Оставляет первые n позиций (откат ходов)
+    void resize(const size_t n)
+    {
+        if (n < entries.size())
+            entries.resize(n);
+    }
+
+    // Добавляет позицию mtx с ходом стороны color по правилам Rules
+    template <class Rules = Russian_rules> void push(const vector<vector<POS_T>> &mtx, const bool color)
+    {
+        constexpr int N = Rules::SIZE;
+        king_moves_limit = Rules::KING_MOVES_DRAW;
+        Entry entry;
+        entry.hash = color ? Zobrist::side<N>() : 0;
+        for (POS_T x = 0; x < N; ++x)
+        {
+            for (POS_T y = 0; y < N; ++y)
+            {
+                if (!mtx[x][y])
+                    continue;
+                const uint64_t key = Zobrist::piece<N>(mtx[x][y], x, y);
+                entry.hash ^= key;
+                if (mtx[x][y] <= 2)
+                    entry.men ^= key;
+                ++entry.pieces;
+            }
+        }
+        if (!entries.empty() && entries.back().men == entry.men && entries.back().pieces == entry.pieces)
+            entry.reversible = entries.back().reversible + 1;
+        entries.push_back(entry);
+    }
+
+    void pop()
+    {
+        entries.pop_back();
+    }
+
+    // Сколько раз последняя позиция встречалась раньше
+    int repetitions() const
+    {
+        if (entries.empty())
+            return 0;
+        const Entry &last = entries.back();
+        int res = 0;
+        // Та же сторона ходит через полуход, серия обратимых ходов ограничивает поиск
+        for (int k = int(entries.size()) - 3, stop = int(entries.size()) - 1 - last.reversible; k >= stop; k -= 2)
+            res += (entries[k].hash == last.hash);
+        return res;
+    }
+
+    // Ничья по правилу ходов дамками
+    bool king_moves_draw() const
+    {
+        return !entries.empty() && entries.back().reversible >= king_moves_limit;
+    }
+
+    // Ничья в партии: позиция повторилась трижды или сработало правило ходов дамками
+    bool is_game_draw() const
+    {
+        return repetitions() >= 2 || king_moves_draw();
+    }
+
+    // Ничья в поиске: достаточно первого повторения, дальше игра пойдёт по кругу
+    bool is_search_draw() const
+    {
+        return repetitions() >= 1 || king_moves_draw();
+    }
+
+  private:
+    struct Entry
+    {
+        uint64_t hash = 0;
+        // хеш одних пешек и число фигур: если они не изменились, ход был обратимым
+        uint64_t men = 0;
+        int pieces = 0;
+        // число обратимых полуходов подряд перед позицией
+        int reversible = 0;
+    };
+
+    vector<Entry> entries;
+    // порог правила ходов дамками в полуходах, берётся из правил последнего push
+    int king_moves_limit = Russian_rules::KING_MOVES_DRAW;
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+
+#include "Full_move.h"
+
+using namespace std;
+
+/*
+Треугольная таблица главного варианта. Строка ply хранит лучшее продолжение из узла,
+до которого от корня сделано ply полных ходов (серия взятий - один ход).
+Когда ход узла улучшает оценку, строка узла собирается из этого хода и строки потомка.
+Память выделяется один раз: MAX_PLY строк по MAX_PLY ходов, более глубокие узлы не записываются.
+Move - тип полного хода (Basic_full_move варианта правил).
+*/
+template <class Move> class Pv_table
+{
+  public:
+    static const int MAX_PLY = 64;
+
+    Pv_table() : moves(MAX_PLY * MAX_PLY), length(MAX_PLY + 1, 0)
+    {
+    }
+
+    // Начало узла ply: его вариант пуст
+    void clear(const int ply)
+    {
+        if (ply < MAX_PLY)
+            length[ply] = ply;
+    }
+
+    // Лучший ход узла ply - move, дальше вариант потомка ply + 1
+    void update(const int ply, const Move &move)
+    {
+        if (ply >= MAX_PLY)
+            return;
+        Move *row = &moves[ply * MAX_PLY];
+        row[ply] = move;
+        int len = ply + 1;
+        if (len < MAX_PLY)
+        {
+            const Move *child = &moves[(ply + 1) * MAX_PLY];
+            for (int k = ply + 1; k < length[ply + 1]; ++k)
+                row[len++] = child[k];
+        }
+        length[ply] = len;
+    }
+
+    // Вариант из узла ply
+    vector<Move> line(const int ply = 0) const
+    {
+        if (ply >= MAX_PLY)
+            return {};
+        const auto row = moves.begin() + ply * MAX_PLY;
+        return vector<Move>(row + ply, row + length[ply]);
+    }
+
+  private:
+    vector<Move> moves;
+    vector<int> length;
+};
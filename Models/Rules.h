@@ -0,0 +1,121 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "Move.h"
+
+using namespace std;
+
+/*
+Геометрия доски и правила варианта шашек - параметры шаблона движка (Basic_logic<Rules>).
+Все размеры и таблицы известны при компиляции, поэтому в горячих циклах нет проверок размера доски.
+Клетки (x, y): x - горизонталь (0 - сторона черных), y - вертикаль; играют на тёмных клетках, (x + y) нечётно.
+Фигуры: 1 - белая пешка, 2 - черная, 3 - белая дамка, 4 - черная.
+*/
+template <int N> struct Board_geometry
+{
+    static constexpr int SIZE = N;
+    // клеток всего и тёмных клеток
+    static constexpr int CELLS = N * N;
+    static constexpr int SQUARES = N * N / 2;
+    static_assert(SQUARES <= 64, "mask of squares must fit into 64 bits");
+    // маска тёмных клеток: 32 бита для 8x8, 64 для 10x10
+    using mask_t = conditional_t<(SQUARES <= 32), uint32_t, uint64_t>;
+
+    // направления диагоналей в порядке перебора ходов
+    static constexpr POS_T DX[4] = {-1, -1, 1, 1};
+    static constexpr POS_T DY[4] = {-1, 1, -1, 1};
+
+    // Номер тёмной клетки (x, y): 0..SQUARES-1
+    static constexpr int square(const int x, const int y)
+    {
+        return (x * N + y) / 2;
+    }
+
+    // Горизонталь превращения пешки piece
+    static constexpr POS_T promotion_row(const POS_T piece)
+    {
+        return piece % 2 ? 0 : N - 1;
+    }
+
+    // Число клеток от (x, y) до края доски по диагонали d
+    static int ray_length(const POS_T x, const POS_T y, const int d)
+    {
+        return rays[x * N + y][d];
+    }
+
+  private:
+    static constexpr array<array<int8_t, 4>, CELLS> make_rays()
+    {
+        array<array<int8_t, 4>, CELLS> res{};
+        for (int x = 0; x < N; ++x)
+        {
+            for (int y = 0; y < N; ++y)
+            {
+                for (int d = 0; d < 4; ++d)
+                {
+                    int len = 0;
+                    for (int i = x + DX[d], j = y + DY[d]; i >= 0 && i < N && j >= 0 && j < N; i += DX[d], j += DY[d])
+                        ++len;
+                    res[x * N + y][d] = int8_t(len);
+                }
+            }
+        }
+        return res;
+    }
+
+    static constexpr array<array<int8_t, 4>, CELLS> rays = make_rays();
+};
+
+// Русские шашки 8x8 в том виде, как их всегда играл движок: пешки бьют назад, дамки дальнобойные,
+// пешка, дошедшая до последней горизонтали во время взятия, продолжает бить дамкой,
+// взятые шашки снимаются сразу после прыжка, любая серия взятий допустима
+struct Russian_rules : Board_geometry<8>
+{
+    static constexpr int START_ROWS = 3;
+    static constexpr bool MEN_CAPTURE_BACKWARD = true;
+    static constexpr bool FLYING_KINGS = true;
+    static constexpr bool PROMOTE_IN_CAPTURE = true;
+    static constexpr bool MAX_CAPTURE = false;
+    static constexpr bool REMOVE_CAPTURED_AT_END = false;
+    // шашек у стороны в начале партии
+    static constexpr int PIECES = START_ROWS * SIZE / 2;
+    // ничья, если обе стороны 15 ходов подряд ходили только дамками без взятий (в полуходах)
+    static constexpr int KING_MOVES_DRAW = 30;
+};
+
+// Международные шашки 10x10: обязательно взятие наибольшего числа шашек, взятые шашки снимаются
+// после хода (через них нельзя перепрыгнуть дважды), пешка превращается, только закончив ход на последней горизонтали
+struct International_rules : Board_geometry<10>
+{
+    static constexpr int START_ROWS = 4;
+    static constexpr bool MEN_CAPTURE_BACKWARD = true;
+    static constexpr bool FLYING_KINGS = true;
+    static constexpr bool PROMOTE_IN_CAPTURE = false;
+    static constexpr bool MAX_CAPTURE = true;
+    static constexpr bool REMOVE_CAPTURED_AT_END = true;
+    static constexpr int PIECES = START_ROWS * SIZE / 2;
+    // правило 25 ходов дамками
+    static constexpr int KING_MOVES_DRAW = 50;
+};
+
+// Начальная позиция варианта Rules: черные сверху, белые снизу
+template <class Rules> vector<vector<POS_T>> start_position()
+{
+    vector<vector<POS_T>> mtx(Rules::SIZE, vector<POS_T>(Rules::SIZE, 0));
+    for (int i = 0; i < Rules::SIZE; ++i)
+    {
+        for (int j = 0; j < Rules::SIZE; ++j)
+        {
+            if ((i + j) % 2 == 0)
+                continue;
+            if (i < Rules::START_ROWS)
+                mtx[i][j] = 2;
+            else if (i >= Rules::SIZE - Rules::START_ROWS)
+                mtx[i][j] = 1;
+        }
+    }
+    return mtx;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+/*
+Ограничения поиска Logic: число узлов, крайний срок и внешний флаг остановки.
+Проверяются не в каждом узле, а раз в poll_interval узлов по счётчику, поэтому почти
+ничего не стоят; узел, в котором сработало ограничение, и все следующие возвращаются сразу,
+а поиск отдаёт лучший ход из досчитанных (см. Logic::find_best_turns_iterative).
+*/
+struct Search_limits
+{
+    // наибольшее число узлов одного поиска (0 - без ограничения)
+    uint64_t max_nodes = 0;
+    // крайний срок поиска
+    chrono::steady_clock::time_point deadline = chrono::steady_clock::time_point::max();
+    // внешний флаг остановки (например, команда stop движка), его меняет другой поток
+    const atomic<bool> *stop = nullptr;
+    // как часто проверять ограничения, в узлах (степень двойки)
+    uint32_t poll_interval = 256;
+
+    // Крайний срок через ms миллисекунд от момента start (по умолчанию - от текущего)
+    void set_movetime(const long long ms, const chrono::steady_clock::time_point start = chrono::steady_clock::now())
+    {
+        deadline = start + chrono::milliseconds(ms);
+    }
+
+    // Снимает ограничения по времени и узлам, флаг остановки остаётся
+    void clear()
+    {
+        max_nodes = 0;
+        deadline = chrono::steady_clock::time_point::max();
+    }
+
+    // Пора ли остановиться после nodes узлов
+    bool reached(const uint64_t nodes) const
+    {
+        return (stop && stop->load(memory_order_relaxed)) || (max_nodes && nodes >= max_nodes) ||
+               (deadline != chrono::steady_clock::time_point::max() && chrono::steady_clock::now() >= deadline);
+    }
+};
@@ -0,0 +1,135 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "Move.h"
+
+using namespace std;
+
+/*
+SearchStats хранит статистику последнего поиска Logic::find_best_turns*, накопленную по всем итерациям
+углубления и повторам с другим окном: число узлов на каждом полуходе, отсечения, время генерации ходов и оценки
+и главный вариант. Счётчики дешёвые, поэтому статистика включена по умолчанию. Время генерации ходов
+и оценки замеряется выборочно: в каждом TIME_SAMPLE-м вызове, с умножением на TIME_SAMPLE,
+поэтому часы в узлах поиска почти не читаются.
+При сборке с -DNO_STATS все обращения к счётчикам удаляются макросом STATS.
+*/
+#ifdef NO_STATS
+    #define STATS(expr)
+#else
+    #define STATS(expr) expr
+#endif
+
+struct SearchStats
+{
+    // максимальное число полуходов, для которых ведётся учёт
+    static const int MAX_PLY = 64;
+    // замеряется время каждого TIME_SAMPLE-го вызова генерации ходов и оценки (степень двойки)
+    static const uint32_t TIME_SAMPLE = 64;
+
+    // число посещённых узлов на каждом полуходе (0 - корень)
+    array<uint64_t, MAX_PLY> nodes{};
+    // число отсечений и отсечений на первом же ходе
+    uint64_t cutoffs = 0;
+    uint64_t first_move_cutoffs = 0;
+    // число вызовов оценочной функции
+    uint64_t evals = 0;
+    // число вызовов генерации ходов
+    uint64_t movegens = 0;
+    // выборочный поиск (O2): сокращённые ходы, продления, отброшенные тихие ходы у листьев
+    uint64_t reductions = 0;
+    uint64_t extensions = 0;
+    uint64_t pruned = 0;
+    // оценки, взятые из таблицы перестановок без перебора
+    uint64_t tt_hits = 0;
+    // время генерации ходов, оценки позиций (оценка по выборке) и всего поиска в наносекундах
+    uint64_t movegen_ns = 0;
+    uint64_t eval_ns = 0;
+    uint64_t total_ns = 0;
+    // главный вариант
+    vector<move_pos> pv;
+
+    void clear()
+    {
+        nodes.fill(0);
+        cutoffs = first_move_cutoffs = evals = movegens = 0;
+        reductions = extensions = pruned = tt_hits = 0;
+        movegen_ns = eval_ns = total_ns = 0;
+        pv.clear();
+    }
+
+    void node(const size_t ply)
+    {
+        ++nodes[ply < MAX_PLY ? ply : MAX_PLY - 1];
+    }
+
+    // move_index - номер хода, на котором произошло отсечение
+    void cutoff(const size_t move_index)
+    {
+        ++cutoffs;
+        first_move_cutoffs += (move_index == 0);
+    }
+
+    // Множитель замера для вызова номер calls: TIME_SAMPLE у каждого TIME_SAMPLE-го вызова, иначе 0 (не замерять)
+    static uint32_t sample(const uint64_t calls)
+    {
+        return (calls & (TIME_SAMPLE - 1)) == 0 ? TIME_SAMPLE : 0;
+    }
+
+    uint64_t total_nodes() const
+    {
+        uint64_t sum = 0;
+        for (auto n : nodes)
+            sum += n;
+        return sum;
+    }
+
+    // глубина, до которой дошёл поиск
+    int max_ply() const
+    {
+        int ply = MAX_PLY - 1;
+        while (ply > 0 && !nodes[ply])
+            --ply;
+        return ply;
+    }
+
+    // эффективный коэффициент ветвления: корень степени max_ply из числа узлов всего поиска
+    double branching_factor() const
+    {
+        const int ply = max_ply();
+        if (ply == 0)
+            return 0;
+        return pow(double(total_nodes()), 1.0 / ply);
+    }
+
+    // доля отсечений, произошедших на первом ходе (качество сортировки ходов)
+    double first_cutoff_rate() const
+    {
+        return cutoffs ? double(first_move_cutoffs) / cutoffs : 0;
+    }
+};
+
+// Добавляет время жизни объекта, умноженное на scale, к счётчику наносекунд.
+// scale = 0 - время не замеряется (выборочный замер, см. SearchStats::sample)
+class Stats_timer
+{
+  public:
+    explicit Stats_timer(uint64_t &counter, const uint32_t scale = 1) : counter(counter), scale(scale)
+    {
+        if (scale)
+            start = chrono::steady_clock::now();
+    }
+    ~Stats_timer()
+    {
+        if (scale)
+            counter += scale * uint64_t(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+    }
+
+  private:
+    uint64_t &counter;
+    const uint32_t scale;
+    chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,196 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if defined(__linux__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <unistd.h>
+    #define SEARCH_TRACE_MMAP
+#endif
+
+using namespace std;
+
+/*
+Запись дерева поиска Logic в двоичный файл для разбора медленных ходов (Tools/trace_analyze.cpp).
+Запись - ребро дерева: ход из узла и итог поиска поддерева под ним. Записи пишутся при выходе
+из поддерева, потомки раньше родителя, поэтому ссылки на родителя не нужны: родитель записи -
+ближайшая следующая запись на полуход ближе к корню. Запись с ply = 0 - поиск корня целиком
+(итерация углубления или повтор с другим окном стремления), она закрывает свои ходы.
+Пишутся только ходы не дальше max_ply полуходов от корня и поддеревья от min_nodes узлов:
+предок всегда больше потомка, так что записанное дерево остаётся связным.
+Файл: Trace_header, затем Trace_record подряд. Запись идёт в окно файла, отображённое в память,
+при заполнении окно сдвигается дальше, а файл удлиняется (только Linux и macOS).
+*/
+
+#pragma pack(push, 1)
+struct Trace_header
+{
+    char magic[4] = {'C', 'K', 'T', 'R'};
+    uint16_t version = 1;
+    uint16_t record_size = 32;
+    // размер доски варианта правил
+    uint8_t board_size = 8;
+    uint8_t reserved[23] = {};
+};
+
+struct Trace_record
+{
+    // хеш Zobrist позиции после хода (у записи корня - позиции корня)
+    uint64_t hash = 0;
+    // узлов в поддереве вместе с повторными поисками хода
+    uint32_t nodes = 0;
+    // окно последнего поиска хода и его оценка (с точки зрения бота, как в Logic)
+    int16_t alpha = 0, beta = 0, score = 0;
+    // клетки начала и конца хода (x * SIZE + y) и число взятий
+    uint8_t from = 0, to = 0, jumps = 0;
+    // полуходов от корня: 1 - ход корня, 0 - запись поиска корня
+    uint8_t ply = 0;
+    // глубина до листьев под ходом (у записи корня - Max_depth)
+    int8_t remaining = 0;
+    // номер хода в списке ходов узла
+    uint8_t index = 0;
+    // ходов, перебранных в узле после хода, и номер хода, давшего отсечение (NO_CUTOFF - не было)
+    uint8_t moves = 0, cutoff = 0;
+    // флаги TRACE_*
+    uint8_t flags = 0;
+    // сколько раз ход искался (нулевое окно, сокращение, полный поиск)
+    uint8_t searches = 0;
+    uint8_t reserved[4] = {};
+};
+#pragma pack(pop)
+
+static_assert(sizeof(Trace_header) == 32 && sizeof(Trace_record) == 32, "trace records must be 32 bytes");
+
+// ход дал отсечение в своём узле
+const uint8_t TRACE_CUTOFF = 1;
+// ход улучшил оценку узла (вошёл в главный вариант узла)
+const uint8_t TRACE_BEST = 2;
+// ход искался с сокращением глубины (O2)
+const uint8_t TRACE_REDUCED = 4;
+// сокращённый поиск не опроверг ход, понадобился поиск на полной глубине
+const uint8_t TRACE_LMR_FAIL = 8;
+// нулевое окно не подтвердило, что ход хуже, ход пересчитан с полным окном
+const uint8_t TRACE_RESEARCH = 16;
+// ветка продлена (угроза превращения)
+const uint8_t TRACE_EXTENDED = 32;
+// номер хода отсечения, если его не было
+const uint8_t NO_CUTOFF = 255;
+
+class Search_trace
+{
+  public:
+    // записываются ходы не дальше max_ply полуходов от корня
+    int max_ply = 4;
+    // и поддеревья не меньше min_nodes узлов
+    uint64_t min_nodes = 0;
+
+    Search_trace() = default;
+    Search_trace(const Search_trace &) = delete;
+    Search_trace &operator=(const Search_trace &) = delete;
+    ~Search_trace()
+    {
+        close();
+    }
+
+    // Создаёт (или перезаписывает) файл трассировки. Возвращает false, если файл не открыт
+    bool open(const string &path, const int board_size = 8)
+    {
+        close();
+#ifdef SEARCH_TRACE_MMAP
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            return false;
+        window_offset = 0;
+        if (!map_window())
+            return false;
+        Trace_header header;
+        header.board_size = uint8_t(board_size);
+        memcpy(window, &header, sizeof(header));
+        used = sizeof(header);
+        count = 0;
+        return true;
+#else
+        (void)path;
+        (void)board_size;
+        return false;
+#endif
+    }
+
+    bool is_open() const
+    {
+        return window != nullptr;
+    }
+
+    // число записей с открытия файла
+    uint64_t records() const
+    {
+        return count;
+    }
+
+    void append(const Trace_record &record)
+    {
+#ifdef SEARCH_TRACE_MMAP
+        if (!window)
+            return;
+        // CHUNK кратен размеру записи, записи не пересекают границу окна
+        if (used == CHUNK)
+        {
+            window_offset += CHUNK;
+            if (!map_window())
+                return;
+        }
+        memcpy(window + used, &record, sizeof(record));
+        used += sizeof(record);
+        ++count;
+#else
+        (void)record;
+#endif
+    }
+
+    // Закрывает файл, обрезая его по последней записи
+    void close()
+    {
+#ifdef SEARCH_TRACE_MMAP
+        if (window)
+            munmap(window, CHUNK);
+        window = nullptr;
+        if (fd >= 0)
+        {
+            // если обрезать не удалось, в конце файла остаются нулевые записи (nodes = 0)
+            [[maybe_unused]] const int res = ftruncate(fd, off_t(window_offset + used));
+            ::close(fd);
+        }
+        fd = -1;
+#endif
+    }
+
+  private:
+#ifdef SEARCH_TRACE_MMAP
+    // Удлиняет файл и отображает окно с window_offset; при ошибке запись прекращается
+    bool map_window()
+    {
+        if (window)
+            munmap(window, CHUNK);
+        window = nullptr;
+        used = 0;
+        if (ftruncate(fd, off_t(window_offset + CHUNK)) != 0)
+            return false;
+        void *mapped = mmap(nullptr, CHUNK, PROT_READ | PROT_WRITE, MAP_SHARED, fd, off_t(window_offset));
+        if (mapped == MAP_FAILED)
+            return false;
+        window = static_cast<char *>(mapped);
+        return true;
+    }
+#endif
+
+    // размер окна: 4 МБ, кратен размеру страницы и записи
+    static const size_t CHUNK = size_t(1) << 22;
+    int fd = -1;
+    char *window = nullptr;
+    // смещение окна в файле и занятая часть окна
+    uint64_t window_offset = 0;
+    size_t used = 0;
+    uint64_t count = 0;
+};
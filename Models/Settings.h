@@ -0,0 +1,165 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <vector>
+using json = nlohmann::json;
+
+using namespace std;
+
+/*
+Настройки из settings.json, разобранные один раз в типизированную структуру.
+Каждое значение проверяется: если его нет, у него неверный тип или оно вне допустимого
+диапазона, берётся значение по умолчанию (или ближайшее допустимое), а в warnings
+записывается описание ошибки. Игра читает настройки из этой структуры, а не из json.
+*/
+
+// Метод оценки позиции (BotScoringType)
+enum class Scoring
+{
+    NumberOnly,
+    NumberAndPotential,
+    Network
+};
+
+// Уровень оптимизации поиска (Optimization)
+enum class Optimization
+{
+    O0,
+    O1,
+    O2
+};
+
+struct Settings
+{
+    // WindowSize, 0 - полный экран
+    int width = 0;
+    int height = 0;
+    // Bot
+    bool is_white_bot = false;
+    bool is_black_bot = true;
+    int white_bot_level = 0;
+    int black_bot_level = 5;
+    Scoring scoring = Scoring::NumberAndPotential;
+    string network_file = "eval.nnue";
+    string eval_params_file = "eval_params.json";
+    int bot_delay_ms = 0;
+    bool no_random = false;
+    Optimization optimization = Optimization::O1;
+    // решатель (Game/Pn_solver.h): вызывается, если фигур на доске не больше solver_pieces (0 - никогда),
+    // и ищет доказанный выигрыш не дольше solver_nodes узлов
+    int solver_pieces = 6;
+    int solver_nodes = 100000;
+    // таблица перестановок бота, МБ (0 - без таблицы), и файл опыта между запусками
+    // (Models/Experience_file.h, пусто - не ведётся) с его наибольшим размером в МБ
+    int hash_mb = 16;
+    string experience_file = "experience.bin";
+    int experience_mb = 24;
+    // Game
+    int max_num_turns = 120;
+    // разбор партии после её окончания (Game/Analysis.h): глубина поиска позиций (-1 - без разбора)
+    // и падение оценки, после которого ход считается ошибкой
+    int analysis_level = 4;
+    int blunder_score = 150;
+
+    // номер версии: увеличивается при каждой перезагрузке, чтобы заметить изменения
+    uint64_t version = 0;
+    // ошибки в settings.json, найденные при разборе
+    vector<string> warnings;
+
+    // Наибольший уровень бота: без оптимизации поиск на большей глубине слишком долгий
+    int max_bot_level() const
+    {
+        return optimization == Optimization::O0 ? 7 : 12;
+    }
+
+    bool is_bot(const bool color) const
+    {
+        return color ? is_black_bot : is_white_bot;
+    }
+
+    int bot_level(const bool color) const
+    {
+        return color ? black_bot_level : white_bot_level;
+    }
+
+    // Разбирает json настроек. Ошибки не прерывают разбор, а попадают в warnings
+    static Settings parse(const json &config)
+    {
+        Settings res;
+        auto section = [&](const char *dir) -> const json & {
+            static const json empty = json::object();
+            if (config.is_object() && config.contains(dir) && config[dir].is_object())
+                return config[dir];
+            res.warnings.push_back(string("missing section ") + dir);
+            return empty;
+        };
+        auto read_int = [&](const json &dir, const char *name, int &value, const int lo, const int hi) {
+            if (!dir.contains(name))
+                return res.warnings.push_back(string("missing ") + name);
+            if (!dir[name].is_number_integer())
+                return res.warnings.push_back(string(name) + " must be an integer");
+            const long long v = dir[name].get<long long>();
+            value = int(max<long long>(lo, min<long long>(hi, v)));
+            if (v != value)
+                res.warnings.push_back(string(name) + " must be in [" + to_string(lo) + ", " + to_string(hi) + "]");
+        };
+        auto read_bool = [&](const json &dir, const char *name, bool &value) {
+            if (!dir.contains(name))
+                return res.warnings.push_back(string("missing ") + name);
+            if (!dir[name].is_boolean())
+                return res.warnings.push_back(string(name) + " must be true or false");
+            value = dir[name].get<bool>();
+        };
+        auto read_string = [&](const json &dir, const char *name, string &value) {
+            if (!dir.contains(name))
+                return res.warnings.push_back(string("missing ") + name);
+            if (!dir[name].is_string())
+                return res.warnings.push_back(string(name) + " must be a string");
+            value = dir[name].get<string>();
+        };
+
+        const json &window = section("WindowSize");
+        read_int(window, "Width", res.width, 0, 1 << 16);
+        read_int(window, "Hight", res.height, 0, 1 << 16);
+
+        const json &bot = section("Bot");
+        read_bool(bot, "IsWhiteBot", res.is_white_bot);
+        read_bool(bot, "IsBlackBot", res.is_black_bot);
+        string scoring = "NumberAndPotential";
+        read_string(bot, "BotScoringType", scoring);
+        if (scoring == "NumberOnly")
+            res.scoring = Scoring::NumberOnly;
+        else if (scoring == "Network")
+            res.scoring = Scoring::Network;
+        else if (scoring != "NumberAndPotential")
+            res.warnings.push_back("unknown BotScoringType " + scoring);
+        read_string(bot, "NetworkFile", res.network_file);
+        read_string(bot, "EvalParamsFile", res.eval_params_file);
+        read_int(bot, "BotDelayMS", res.bot_delay_ms, 0, 60000);
+        read_bool(bot, "NoRandom", res.no_random);
+        string optimization = "O1";
+        read_string(bot, "Optimization", optimization);
+        if (optimization == "O0")
+            res.optimization = Optimization::O0;
+        else if (optimization == "O2")
+            res.optimization = Optimization::O2;
+        else if (optimization != "O1")
+            res.warnings.push_back("unknown Optimization " + optimization);
+        // Уровни проверяются после Optimization: от него зависит наибольший уровень
+        read_int(bot, "WhiteBotLevel", res.white_bot_level, 0, res.max_bot_level());
+        read_int(bot, "BlackBotLevel", res.black_bot_level, 0, res.max_bot_level());
+        read_int(bot, "SolverPieces", res.solver_pieces, 0, 24);
+        read_int(bot, "SolverNodes", res.solver_nodes, 1, 100000000);
+        read_int(bot, "HashMB", res.hash_mb, 0, 4096);
+        read_string(bot, "ExperienceFile", res.experience_file);
+        read_int(bot, "ExperienceMB", res.experience_mb, 1, 1024);
+
+        const json &game = section("Game");
+        read_int(game, "MaxNumTurns", res.max_num_turns, 1, 10000);
+        read_int(game, "AnalysisLevel", res.analysis_level, -1, res.max_bot_level());
+        read_int(game, "BlunderScore", res.blunder_score, 1, 100000);
+        return res;
+    }
+};
@@ -0,0 +1,359 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+
+#if defined(__linux__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define TT_SHARED_MEMORY
+#endif
+
+using namespace std;
+
+/*
+Таблица перестановок: результаты поиска позиций по хешу Zobrist (оценка, граница, глубина, лучший ход).
+Таблицу могут использовать несколько Logic сразу - потоки одного процесса через общий объект, а процессы
+одной машины через именованный сегмент общей памяти POSIX (open_shared: shm_open и mmap, только Linux
+и macOS). Блокировок нет: запись - два 64-битных слова (ключ XOR данные, данные), каждое пишется
+атомарно. Если два потока пишут одну запись одновременно и слова перемешались, ключ XOR данные
+не совпадёт с хешем позиции, и запись просто не найдётся, поэтому прочитанные данные всегда целые.
+Память ограничена при создании: размер сегмента задаёт первый процесс, остальные подключаются
+к нему целиком, сколько бы их ни было. Оценки зависят от метода оценки, её параметров и весов сети,
+поэтому в заголовке сегмента записан их отпечаток (Logic::eval_fingerprint): процесс с другой оценкой
+к сегменту не подключается и ищет со своей таблицей. Записи сгруппированы по две: первая заменяется более глубоким
+поиском или поиском нового поколения, вторая - всегда.
+*/
+
+// Отпечаток данных (FNV-1a), hash - отпечаток предыдущих данных при хешировании по частям
+inline uint64_t fnv1a_hash(const void *data, const size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    for (size_t k = 0; k < size; ++k)
+    {
+        hash ^= bytes[k];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Граница оценки записи
+enum Tt_bound : uint8_t
+{
+    TT_NONE = 0,
+    // оценка не меньше записанной (было отсечение)
+    TT_LOWER = 1,
+    // оценка не больше записанной (ни один ход не улучшил окно)
+    TT_UPPER = 2,
+    TT_EXACT = 3
+};
+
+// Результат поиска позиции, упакованный в 64 бита
+struct Tt_data
+{
+    // оценка с точки зрения ходящей стороны, выигрыш - в полуходах от позиции
+    int16_t score = 0;
+    // глубина поиска от позиции до листьев
+    int8_t draft = 0;
+    Tt_bound bound = TT_NONE;
+    // поколение (номер поиска) по модулю 64
+    uint8_t generation = 0;
+    // лучший ход в виде, который выбирает Logic (0 - нет)
+    uint32_t move = 0;
+
+    uint64_t pack() const
+    {
+        return uint64_t(uint16_t(score)) | uint64_t(uint8_t(draft)) << 16 | uint64_t(bound) << 24 |
+               uint64_t(generation & 63) << 26 | uint64_t(move) << 32;
+    }
+
+    static Tt_data unpack(const uint64_t bits)
+    {
+        Tt_data data;
+        data.score = int16_t(uint16_t(bits));
+        data.draft = int8_t(uint8_t(bits >> 16));
+        data.bound = Tt_bound((bits >> 24) & 3);
+        data.generation = uint8_t((bits >> 26) & 63);
+        data.move = uint32_t(bits >> 32);
+        return data;
+    }
+};
+
+class Transposition_table
+{
+  public:
+    // наибольший размер таблицы
+    static const size_t MAX_MB = 1 << 16;
+
+    explicit Transposition_table(const size_t mb = 16)
+    {
+        resize(mb);
+    }
+    Transposition_table(const Transposition_table &) = delete;
+    Transposition_table &operator=(const Transposition_table &) = delete;
+    ~Transposition_table()
+    {
+        release();
+    }
+
+    // Своя таблица процесса размером mb мегабайт (не меньше одной корзины), очищенная
+    void resize(const size_t mb)
+    {
+        release();
+        buckets = bucket_count(mb);
+        own = make_unique<Bucket[]>(buckets);
+        table = own.get();
+        generation = &own_generation;
+    }
+
+    // Подключается к сегменту общей памяти name ("/checkers_tt") или создаёт его размером mb мегабайт.
+    // Существующий сегмент берётся целиком с его размером. board_size - размер доски, eval - отпечаток
+    // оценки: сегмент другого варианта правил или другой оценки не подходит.
+    // При ошибке таблица остаётся своей и возвращается false
+    bool open_shared(const string &name, const size_t mb, const int board_size = 8, const uint64_t eval = 0)
+    {
+#ifdef TT_SHARED_MEMORY
+        const size_t own_mb = size_mb();
+        release();
+        bool created = true;
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0)
+        {
+            created = false;
+            fd = shm_open(name.c_str(), O_RDWR, 0600);
+        }
+        if (fd < 0)
+            return fail_shared(own_mb);
+        size_t size = sizeof(Header) + bucket_count(mb) * sizeof(Bucket);
+        if (created)
+        {
+            if (ftruncate(fd, off_t(size)) != 0)
+            {
+                ::close(fd);
+                shm_unlink(name.c_str());
+                return fail_shared(own_mb);
+            }
+        }
+        else
+        {
+            // Создатель мог ещё не задать размер сегмента: ждём до секунды
+            struct stat st;
+            for (int k = 0; k < 1000 && (fstat(fd, &st) != 0 || st.st_size == 0); ++k)
+                this_thread::sleep_for(chrono::milliseconds(1));
+            if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(Header) + sizeof(Bucket))
+            {
+                ::close(fd);
+                return fail_shared(own_mb);
+            }
+            size = size_t(st.st_size);
+        }
+        void *mapped = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+            return fail_shared(own_mb);
+        Header *header = static_cast<Header *>(mapped);
+        const size_t count = (size - sizeof(Header)) / sizeof(Bucket);
+        if (created)
+        {
+            // Новый сегмент заполнен нулями: остаётся заголовок, метка пишется последней
+            header->buckets = count;
+            header->board_size = uint32_t(board_size);
+            header->eval = eval;
+            header->magic.store(MAGIC, memory_order_release);
+        }
+        else
+        {
+            for (int k = 0; k < 1000 && header->magic.load(memory_order_acquire) != MAGIC; ++k)
+                this_thread::sleep_for(chrono::milliseconds(1));
+            if (header->magic.load(memory_order_acquire) != MAGIC || header->board_size != uint32_t(board_size) ||
+                header->eval != eval || header->buckets != count)
+            {
+                munmap(mapped, size);
+                return fail_shared(own_mb);
+            }
+        }
+        shared = header;
+        shared_size = size;
+        buckets = count;
+        table = reinterpret_cast<Bucket *>(header + 1);
+        generation = &header->generation;
+        return true;
+#else
+        (void)name;
+        (void)mb;
+        (void)board_size;
+        (void)eval;
+        return false;
+#endif
+    }
+
+    // Удаляет имя сегмента: подключённые процессы работают дальше, новые создадут новый сегмент
+    static bool remove_shared(const string &name)
+    {
+#ifdef TT_SHARED_MEMORY
+        return shm_unlink(name.c_str()) == 0;
+#else
+        (void)name;
+        return false;
+#endif
+    }
+
+    bool is_shared() const
+    {
+        return shared != nullptr;
+    }
+
+    size_t size_mb() const
+    {
+        return buckets * sizeof(Bucket) >> 20;
+    }
+
+    // Очищает записи (у общей таблицы - для всех подключённых процессов)
+    void clear()
+    {
+        for (size_t k = 0; k < buckets; ++k)
+            for (auto &entry : table[k].entries)
+            {
+                entry.check.store(0, memory_order_relaxed);
+                entry.data.store(0, memory_order_relaxed);
+            }
+    }
+
+    // Начало нового поиска: записи прошлых поколений заменяются в первую очередь
+    void new_search()
+    {
+        generation->fetch_add(1, memory_order_relaxed);
+    }
+
+    // Ищет позицию key. false - записи нет или она повреждена одновременной записью
+    bool probe(const uint64_t key, Tt_data &res) const
+    {
+        for (const auto &entry : table[key % buckets].entries)
+        {
+            const uint64_t data = entry.data.load(memory_order_relaxed);
+            if (data && (entry.check.load(memory_order_relaxed) ^ data) == key)
+            {
+                res = Tt_data::unpack(data);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void store(const uint64_t key, Tt_data data)
+    {
+        const uint8_t current = uint8_t(generation->load(memory_order_relaxed) & 63);
+        data.generation = current;
+        Entry *entries = table[key % buckets].entries;
+        // Первая запись корзины хранит самый глубокий поиск текущего поколения, вторая - последний
+        Entry *target = &entries[1];
+        const uint64_t first = entries[0].data.load(memory_order_relaxed);
+        const Tt_data old = Tt_data::unpack(first);
+        if (!first || (entries[0].check.load(memory_order_relaxed) ^ first) == key || old.generation != current ||
+            data.draft >= old.draft)
+            target = &entries[0];
+        // Ход из прежней записи этой позиции сохраняется, если новый поиск хода не нашёл
+        if (!data.move)
+        {
+            Tt_data prev;
+            if (probe(key, prev))
+                data.move = prev.move;
+        }
+        const uint64_t bits = data.pack();
+        target->check.store(key ^ bits, memory_order_relaxed);
+        target->data.store(bits, memory_order_relaxed);
+    }
+
+    // Перебирает записи таблицы: fn(key, data). Ключ восстанавливается из проверочного слова
+    template <class Fn> void for_each(Fn fn) const
+    {
+        for (size_t k = 0; k < buckets; ++k)
+            for (const auto &entry : table[k].entries)
+            {
+                const uint64_t data = entry.data.load(memory_order_relaxed);
+                if (data)
+                    fn(entry.check.load(memory_order_relaxed) ^ data, Tt_data::unpack(data));
+            }
+    }
+
+    // Доля (в тысячных) записей текущего поколения среди первых 1000 записей, как hashfull в UCI
+    int hashfull() const
+    {
+        const uint8_t current = uint8_t(generation->load(memory_order_relaxed) & 63);
+        const size_t count = min<size_t>(buckets, 500);
+        int used = 0;
+        for (size_t k = 0; k < count; ++k)
+            for (const auto &entry : table[k].entries)
+            {
+                const uint64_t data = entry.data.load(memory_order_relaxed);
+                used += data && Tt_data::unpack(data).generation == current;
+            }
+        return int(used * 1000 / (2 * count));
+    }
+
+  private:
+    struct Entry
+    {
+        atomic<uint64_t> check{0};
+        atomic<uint64_t> data{0};
+    };
+    struct Bucket
+    {
+        Entry entries[2];
+    };
+    // Заголовок сегмента общей памяти, записи - сразу за ним
+    struct alignas(64) Header
+    {
+        atomic<uint32_t> magic{0};
+        uint32_t board_size = 0;
+        uint64_t buckets = 0;
+        atomic<uint32_t> generation{0};
+        // отпечаток оценки, которой посчитаны записи
+        uint64_t eval = 0;
+    };
+    static_assert(atomic<uint64_t>::is_always_lock_free && atomic<uint32_t>::is_always_lock_free,
+                  "shared entries need lock-free atomics");
+    // "CKT2": заголовок с отпечатком оценки
+    static const uint32_t MAGIC = 0x32544B43;
+
+    static size_t bucket_count(const size_t mb)
+    {
+        return max<size_t>(1, (min(mb, MAX_MB) << 20) / sizeof(Bucket));
+    }
+
+    // Отказ от общей памяти: своя таблица прежнего размера
+    bool fail_shared(const size_t mb)
+    {
+        resize(mb);
+        return false;
+    }
+
+    void release()
+    {
+#ifdef TT_SHARED_MEMORY
+        if (shared)
+            munmap(shared, shared_size);
+#endif
+        shared = nullptr;
+        own.reset();
+        table = nullptr;
+        buckets = 0;
+    }
+
+    Bucket *table = nullptr;
+    size_t buckets = 0;
+    // своя память или отображённый сегмент
+    unique_ptr<Bucket[]> own;
+    void *shared = nullptr;
+    size_t shared_size = 0;
+    // счётчик поколений: свой или в заголовке сегмента
+    atomic<uint32_t> own_generation{0};
+    atomic<uint32_t> *generation = &own_generation;
+};
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "Move.h"
+
+using namespace std;
+
+/*
+Хеширование позиций по Зобристу: у каждой пары (фигура, клетка) и у хода черных
+своё случайное 64-битное число, хеш позиции - XOR чисел всех фигур на доске.
+Ключи одинаковы во всех запусках (фиксированное зерно), поэтому хеши можно хранить в файлах.
+N - размер доски (Rules::SIZE), у каждого размера свой набор ключей.
+*/
+class Zobrist
+{
+  public:
+    // Ключ фигуры piece (1..4) на клетке (x, y)
+    template <int N = 8> static uint64_t piece(const POS_T piece, const POS_T x, const POS_T y)
+    {
+        return keys<N>().pieces[piece - 1][x * N + y];
+    }
+
+    // Ключ хода черных
+    template <int N = 8> static uint64_t side()
+    {
+        return keys<N>().side;
+    }
+
+    // Хеш позиции mtx с ходом стороны color
+    template <int N = 8> static uint64_t hash(const vector<vector<POS_T>> &mtx, const bool color)
+    {
+        uint64_t res = color ? side<N>() : 0;
+        for (POS_T x = 0; x < N; ++x)
+            for (POS_T y = 0; y < N; ++y)
+                if (mtx[x][y])
+                    res ^= piece<N>(mtx[x][y], x, y);
+        return res;
+    }
+
+  private:
+    template <int N> struct Keys
+    {
+        uint64_t pieces[4][N * N];
+        uint64_t side;
+
+        Keys()
+        {
+            mt19937_64 rng(0x636865636b657273ULL);
+            for (auto &row : pieces)
+                for (auto &key : row)
+                    key = rng();
+            side = rng();
+        }
+    };
+
+    template <int N> static const Keys<N> &keys()
+    {
+        static const Keys<N> instance;
+        return instance;
+    }
+};
@@ -0,0 +1,316 @@
+/*
+Сервер пакетного анализа позиций через локальный сокет (Unix domain socket, Linux).
+Долгоживущий процесс с пулом потоков, у каждого потока свой экземпляр Logic,
+который переиспользуется между запросами. Все потоки ищут с одной таблицей перестановок
+размером --hash МБ (0 - без таблицы), она живёт весь запуск: позиции прошлых запросов
+и их продолжения ищутся быстрее. Клиент отправляет позиции строками:
+    analyse <id> [depth N] [movetime MS] [nodes N] fen <FEN>
+и получает ответы по мере готовности (порядок ответов может отличаться от порядка запросов):
+    result <id> bestmove <ход> score <S> depth <D> nodes <N> time <MS> pv <ход> <ответ> ...
+    error <id> <описание>
+Оценка S записывается как в движке: "cp 120", "win 3" или "loss 2".
+Очередь заданий ограничена: когда она заполнена, сервер перестаёт читать сокет клиента,
+и клиент блокируется на записи (обратное давление). Глубина и время каждого запроса
+ограничены значениями --max-depth и --max-movetime.
+
+Сборка (Linux):
+    g++ -O2 -std=c++17 -pthread $(sdl2-config --cflags) Server/analysis_server.cpp -o analysis_server
+Запуск из корня проекта (нужен settings.json):
+    ./analysis_server [--socket /tmp/checkers_analysis.sock] [--workers N] [--queue N]
+                      [--max-depth N] [--max-movetime MS] [--hash MB]
+*/
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "../Game/Logic.h"
+#include "../Models/Fen.h"
+#include "../Models/Transposition_table.h"
+
+using namespace std;
+
+namespace
+{
+// Подключение клиента. Сокет закрывается, когда его больше не держат ни читатель, ни задания
+class Connection
+{
+  public:
+    explicit Connection(const int fd) : fd(fd)
+    {
+    }
+    ~Connection()
+    {
+        close(fd);
+    }
+
+    // Отправляет строку целиком; после ошибки записи подключение считается закрытым
+    void send_line(const string &line)
+    {
+        lock_guard<mutex> lock(write_mutex);
+        if (closed)
+            return;
+        const string data = line + "\n";
+        for (size_t sent = 0; sent < data.size();)
+        {
+            const ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+            {
+                closed = true;
+                return;
+            }
+            sent += n;
+        }
+    }
+
+    const int fd;
+    atomic<bool> closed{false};
+
+  private:
+    mutex write_mutex;
+};
+
+struct Job
+{
+    shared_ptr<Connection> conn;
+    string id;
+    fen_position pos;
+    // глубина в полуходах, как в протоколе (Max_depth у Logic на единицу меньше)
+    int depth;
+    long long movetime;
+    // 0 - без ограничения
+    uint64_t nodes = 0;
+};
+
+// Ограниченная очередь заданий: push блокируется, пока в очереди нет места
+class Job_queue
+{
+  public:
+    explicit Job_queue(const size_t capacity) : capacity(capacity)
+    {
+    }
+
+    void push(Job job)
+    {
+        unique_lock<mutex> lock(mtx);
+        not_full.wait(lock, [this] { return jobs.size() < capacity; });
+        jobs.push_back(move(job));
+        not_empty.notify_one();
+    }
+
+    Job pop()
+    {
+        unique_lock<mutex> lock(mtx);
+        not_empty.wait(lock, [this] { return !jobs.empty(); });
+        Job job = move(jobs.front());
+        jobs.pop_front();
+        not_full.notify_one();
+        return job;
+    }
+
+  private:
+    const size_t capacity;
+    deque<Job> jobs;
+    mutex mtx;
+    condition_variable not_full, not_empty;
+};
+
+struct Server_options
+{
+    string socket_path = "/tmp/checkers_analysis.sock";
+    unsigned workers = max(1u, thread::hardware_concurrency());
+    size_t queue = 256;
+    // наибольшая глубина запроса в полуходах
+    int max_depth = 12;
+    long long max_movetime = 10000;
+    // размер общей таблицы перестановок, МБ
+    size_t hash_mb = 64;
+};
+
+// Поток-исполнитель: держит свой Logic между заданиями. tt - общая таблица пула (nullptr - без неё)
+void worker(Config *config, Job_queue *queue, Transposition_table *tt)
+{
+    Logic logic(nullptr, config);
+    logic.tt = tt;
+    while (true)
+    {
+        Job job = queue->pop();
+        // Клиент уже отключился, считать незачем
+        if (job.conn->closed)
+            continue;
+        const auto start = chrono::steady_clock::now();
+        logic.limits.set_movetime(job.movetime, start);
+        logic.limits.max_nodes = job.nodes;
+        const auto mtx = to_mtx(job.pos);
+        const auto best = logic.find_best_turns_iterative(mtx, job.pos.color, job.depth - 1);
+        const auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+
+        ostringstream out;
+        out << "result " << job.id << " bestmove " << move_to_string(best) << " score " << score_to_string(logic.best_score)
+            << " depth " << logic.completed_depth + 1 << " nodes " << logic.searched_nodes << " time " << ms.count()
+            << " pv " << line_to_string(logic.pv);
+        job.conn->send_line(out.str());
+    }
+}
+
+// Разбирает строку запроса в задание. Возвращает текст ошибки или пустую строку
+string parse_request(const string &line, const Server_options &options, Job &job)
+{
+    istringstream in(line);
+    string cmd;
+    in >> cmd >> job.id;
+    if (cmd != "analyse" || job.id.empty())
+        return "expected: analyse <id> [depth N] [movetime MS] [nodes N] fen <FEN>";
+    job.depth = options.max_depth;
+    job.movetime = options.max_movetime;
+    string token;
+    while (in >> token)
+    {
+        if (token == "depth" && in >> job.depth)
+            job.depth = max(1, min(job.depth, options.max_depth));
+        else if (token == "movetime" && in >> job.movetime)
+            job.movetime = max(1LL, min(job.movetime, options.max_movetime));
+        else if (token == "nodes" && in >> job.nodes)
+            continue;
+        else if (token == "fen")
+        {
+            string fen;
+            getline(in >> ws, fen);
+            if (!parse_fen(fen, job.pos))
+                return "bad fen";
+            return "";
+        }
+        else
+            return "unknown token " + token;
+    }
+    return "missing fen";
+}
+
+// Читает запросы клиента построчно и ставит их в очередь
+void serve_client(const int fd, const Server_options *options, Job_queue *queue)
+{
+    auto conn = make_shared<Connection>(fd);
+    string buffer;
+    char chunk[4096];
+    while (!conn->closed)
+    {
+        const ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+            break;
+        buffer.append(chunk, n);
+        size_t begin = 0, end;
+        while ((end = buffer.find('\n', begin)) != string::npos)
+        {
+            string line = buffer.substr(begin, end - begin);
+            begin = end + 1;
+            if (!line.empty() && line.back() == '\r')
+                line.pop_back();
+            if (line.empty())
+                continue;
+            Job job;
+            const string error = parse_request(line, *options, job);
+            if (!error.empty())
+            {
+                conn->send_line("error " + (job.id.empty() ? string("-") : job.id) + " " + error);
+                continue;
+            }
+            job.conn = conn;
+            // Блокируется, если очередь заполнена
+            queue->push(move(job));
+        }
+        buffer.erase(0, begin);
+        if (buffer.size() > 65536)
+        {
+            conn->send_line("error - line too long");
+            break;
+        }
+    }
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Server_options options;
+    for (int k = 1; k < argc; ++k)
+    {
+        const string arg = argv[k];
+        if (k + 1 >= argc)
+        {
+            cerr << "missing value for " << arg << endl;
+            return 1;
+        }
+        if (arg == "--socket")
+            options.socket_path = argv[++k];
+        else if (arg == "--workers")
+            options.workers = max(1, stoi(argv[++k]));
+        else if (arg == "--queue")
+            options.queue = max(1, stoi(argv[++k]));
+        else if (arg == "--max-depth")
+            options.max_depth = max(1, stoi(argv[++k]));
+        else if (arg == "--max-movetime")
+            options.max_movetime = max(1LL, stoll(argv[++k]));
+        else if (arg == "--hash")
+            options.hash_mb = size_t(max(0LL, min(stoll(argv[++k]), (long long)Transposition_table::MAX_MB)));
+        else
+        {
+            cerr << "unknown option " << arg << endl;
+            return 1;
+        }
+    }
+
+    // Ошибки записи в закрытый сокет обрабатываются через send, а не сигналом
+    signal(SIGPIPE, SIG_IGN);
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (options.socket_path.size() >= sizeof(addr.sun_path))
+    {
+        cerr << "socket path is too long" << endl;
+        return 1;
+    }
+    strcpy(addr.sun_path, options.socket_path.c_str());
+    const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(options.socket_path.c_str());
+    if (listen_fd < 0 || bind(listen_fd, (sockaddr *)&addr, sizeof(addr)) < 0 || listen(listen_fd, 64) < 0)
+    {
+        cerr << "can't listen on " << options.socket_path << ": " << strerror(errno) << endl;
+        return 1;
+    }
+
+    Config config;
+    Job_queue queue(options.queue);
+    Transposition_table tt(options.hash_mb);
+    for (unsigned k = 0; k < options.workers; ++k)
+        thread(worker, &config, &queue, options.hash_mb ? &tt : nullptr).detach();
+    cerr << "listening on " << options.socket_path << " with " << options.workers << " workers, hash "
+         << options.hash_mb << " MB" << endl;
+
+    while (true)
+    {
+        const int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            cerr << "accept failed: " << strerror(errno) << endl;
+            break;
+        }
+        thread(serve_client, fd, &options, &queue).detach();
+    }
+    close(listen_fd);
+    unlink(options.socket_path.c_str());
+    return 1;
+}
@@ -0,0 +1,133 @@
+/*
+Матч между двумя настройками бота без окна: для проверки изменений в поиске и оценке.
+Каждая стартовая позиция из файла FEN играется дважды со сменой цветов,
+партии распределяются по потокам.
+
+Сборка (Linux):
+    g++ -O2 -std=c++17 -pthread $(sdl2-config --cflags) Tools/match.cpp -o match
+Запуск из корня проекта (нужен settings.json):
+    ./match [--a O2] [--b O1] [--level 5] [--openings Benchmarks/positions.fen] [--games 100]
+            [--max-turns 120] [--threads N] [--a-eval Network] [--b-eval NumberAndPotential] [--network eval.nnue]
+            [--a-params tuned.json] [--b-params eval_params.json]
+--a и --b - значения Optimization для двух ботов, level - BotLevel обоих ботов,
+--a-eval и --b-eval - их BotScoringType (по умолчанию из settings.json), --network - NetworkFile обоих,
+--a-params и --b-params - их EvalParamsFile.
+*/
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Game/Match.h"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    string opt_a = "O2", opt_b = "O1", openings_path = "Benchmarks/positions.fen", eval_a, eval_b, network, params_a, params_b;
+    int level = 5, games = 100, max_turns = 120;
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    for (int k = 1; k + 1 < argc; k += 2)
+    {
+        const string arg = argv[k], value = argv[k + 1];
+        if (arg == "--a")
+            opt_a = value;
+        else if (arg == "--b")
+            opt_b = value;
+        else if (arg == "--level")
+            level = stoi(value);
+        else if (arg == "--openings")
+            openings_path = value;
+        else if (arg == "--games")
+            games = stoi(value);
+        else if (arg == "--max-turns")
+            max_turns = stoi(value);
+        else if (arg == "--threads")
+            threads = max(1, stoi(value));
+        else if (arg == "--a-eval")
+            eval_a = value;
+        else if (arg == "--b-eval")
+            eval_b = value;
+        else if (arg == "--network")
+            network = value;
+        else if (arg == "--a-params")
+            params_a = value;
+        else if (arg == "--b-params")
+            params_b = value;
+        else
+        {
+            cerr << "unknown option " << arg << endl;
+            return 1;
+        }
+    }
+    auto openings = load_fen_file(openings_path);
+    openings.resize(min(openings.size(), size_t(max(1, games / 2))));
+
+    Config config_a, config_b;
+    config_a.set("Bot", "Optimization", opt_a);
+    config_b.set("Bot", "Optimization", opt_b);
+    if (!eval_a.empty())
+        config_a.set("Bot", "BotScoringType", eval_a);
+    if (!eval_b.empty())
+        config_b.set("Bot", "BotScoringType", eval_b);
+    if (!params_a.empty())
+        config_a.set("Bot", "EvalParamsFile", params_a);
+    if (!params_b.empty())
+        config_b.set("Bot", "EvalParamsFile", params_b);
+    if (!network.empty())
+    {
+        config_a.set("Bot", "NetworkFile", network);
+        config_b.set("Bot", "NetworkFile", network);
+    }
+
+    // Итоги с точки зрения бота A
+    atomic<int> wins{0}, draws{0}, losses{0};
+    atomic<size_t> next_game{0};
+    mutex stats_mutex;
+    double think_ms[2] = {0, 0};
+    int moves[2] = {0, 0};
+
+    auto worker = [&] {
+        Logic a(nullptr, &config_a), b(nullptr, &config_b);
+        const int levels[2] = {level, level};
+        size_t k;
+        while ((k = next_game++) < openings.size() * 2)
+        {
+            // Чётные партии A играет белыми, нечётные - черными
+            const bool a_black = k % 2;
+            Logic *bots[2] = {a_black ? &b : &a, a_black ? &a : &b};
+            const auto game = play_match_game(bots, levels, openings[k / 2], max_turns);
+            if (game.result == 0)
+                ++draws;
+            else if ((game.result == 2) == a_black)
+                ++wins;
+            else
+                ++losses;
+            lock_guard<mutex> lock(stats_mutex);
+            think_ms[0] += game.think_ms[a_black];
+            think_ms[1] += game.think_ms[!a_black];
+            moves[0] += game.moves[a_black];
+            moves[1] += game.moves[!a_black];
+        }
+    };
+    vector<thread> pool;
+    for (unsigned k = 0; k < threads; ++k)
+        pool.emplace_back(worker);
+    for (auto &th : pool)
+        th.join();
+
+    const int total = wins + draws + losses;
+    const double score = total ? (wins + 0.5 * draws) / total : 0.5;
+    // Оценка разницы в рейтинге Эло по доле набранных очков
+    const double elo = (score > 0 && score < 1) ? -400 * log10(1 / score - 1) : (score > 0 ? 999 : -999);
+    printf("%s vs %s, level %d, %d games: +%d =%d -%d, score %.1f%%, elo %+.0f\n", opt_a.c_str(), opt_b.c_str(),
+           level, total, int(wins), int(draws), int(losses), score * 100, elo);
+    printf("average move time: %s %.1f ms, %s %.1f ms\n", opt_a.c_str(), moves[0] ? think_ms[0] / moves[0] : 0.0,
+           opt_b.c_str(), moves[1] ? think_ms[1] / moves[1] : 0.0);
+    return 0;
+}
@@ -0,0 +1,138 @@
+/*
+Perft: число позиций после всех последовательностей из N полных ходов (серия взятий - один ход).
+Проверка генератора ходов Logic::find_moves и make_move: после изменений в генераторе числа
+от начальной позиции должны совпасть с записанными ниже, иначе программа выходит с кодом 1.
+Для международных шашек записаны опубликованные числа, для русских - числа этого генератора,
+совпадающие с генератором до шаблонных правил (Models/Rules.h). Круговые взятия одних и тех же
+шашек в разные стороны считаются разными ходами, как их перебирает поиск.
+
+Сборка (Linux):
+    g++ -O2 -std=c++17 $(sdl2-config --cflags) Tools/perft.cpp -o perft
+Запуск из корня проекта (нужен settings.json):
+    ./perft [--rules russian|international] [--depth N] [--fen <FEN>]
+Без --depth считается до последней записанной глубины. --fen (только русские шашки) - своя позиция,
+для неё числа только печатаются.
+*/
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../Game/Logic.h"
+#include "../Models/Fen.h"
+
+using namespace std;
+
+namespace
+{
+// Числа perft от начальной позиции, глубины 1, 2, ...
+const vector<uint64_t> russian_counts = {7, 49, 302, 1469, 7482, 37986, 190146, 929984, 4571392};
+const vector<uint64_t> international_counts = {9, 81, 658, 4265, 27117, 167140, 1049442, 6483961, 41022423};
+
+template <class Rules> class Perft
+{
+  public:
+    explicit Perft(Config *config) : logic(nullptr, config)
+    {
+    }
+
+    uint64_t count(const vector<vector<POS_T>> &mtx, const bool color, const int depth)
+    {
+        if (lists.size() <= size_t(depth))
+            lists.resize(depth + 1);
+        auto &moves = lists[depth];
+        auto board = mtx;
+        logic.find_moves(color, board, moves);
+        if (depth == 1)
+            return moves.size();
+        uint64_t nodes = 0;
+        for (const auto &move : moves)
+            nodes += count(logic.make_move(mtx, move), !color, depth - 1);
+        return nodes;
+    }
+
+  private:
+    Basic_logic<Rules> logic;
+    // ходы по оставшейся глубине (память переиспользуется)
+    vector<vector<typename Basic_logic<Rules>::Full_move>> lists;
+};
+
+// Считает perft на глубинах 1..depth; expected - записанные числа (пустой - без проверки).
+// Возвращает false при расхождении
+template <class Rules>
+bool run(Config *config, const vector<vector<POS_T>> &mtx, const bool color, const int depth,
+         const vector<uint64_t> &expected)
+{
+    Perft<Rules> perft(config);
+    bool ok = true;
+    for (int d = 1; d <= depth; ++d)
+    {
+        const auto start = chrono::steady_clock::now();
+        const uint64_t nodes = perft.count(mtx, color, d);
+        const auto ms = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start).count();
+        cout << "depth " << d << " nodes " << nodes << " time " << ms;
+        if (size_t(d) <= expected.size())
+        {
+            const bool match = (nodes == expected[d - 1]);
+            cout << (match ? " ok" : " FAIL expected " + to_string(expected[d - 1]));
+            ok = ok && match;
+        }
+        cout << endl;
+    }
+    return ok;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    string rules = "russian", fen;
+    int depth = -1;
+    for (int k = 1; k + 1 < argc; k += 2)
+    {
+        const string arg = argv[k], value = argv[k + 1];
+        if (arg == "--rules")
+            rules = value;
+        else if (arg == "--depth")
+            depth = stoi(value);
+        else if (arg == "--fen")
+            fen = value;
+        else
+        {
+            cerr << "unknown option " << arg << endl;
+            return 1;
+        }
+    }
+
+    Config config;
+    bool ok = true;
+    if (rules == "russian")
+    {
+        auto mtx = start_position<Russian_rules>();
+        bool color = 0;
+        if (!fen.empty())
+        {
+            fen_position pos;
+            if (!parse_fen(fen, pos))
+            {
+                cerr << "bad fen " << fen << endl;
+                return 1;
+            }
+            mtx = to_mtx(pos);
+            color = pos.color;
+        }
+        const auto &expected = fen.empty() ? russian_counts : vector<uint64_t>();
+        ok = run<Russian_rules>(&config, mtx, color, depth < 0 ? int(russian_counts.size()) : depth, expected);
+    }
+    else if (rules == "international" && fen.empty())
+    {
+        ok = run<International_rules>(&config, start_position<International_rules>(), 0,
+                                      depth < 0 ? int(international_counts.size()) : depth, international_counts);
+    }
+    else
+    {
+        cerr << "expected --rules russian or international (--fen only for russian)" << endl;
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,256 @@
+/*
+Разбор файла дерева поиска (Models/Search_trace.h): где поиск потратил узлы и где не сработали отсечения.
+Файл пишет движок (Engine/engine.cpp) с настройкой TraceFile:
+    setoption name TraceFile value trace.bin
+    setoption name TraceDepth value 4
+    position fen <FEN>
+    go depth 7
+
+Сборка (Linux):
+    g++ -O2 -std=c++17 Tools/trace_analyze.cpp -o trace_analyze
+Запуск:
+    ./trace_analyze trace.bin [--top 10] [--ply P]
+Печатает поиски корня (итерации и повторы с другим окном стремления), сводку по полуходам,
+самые дорогие поддеревья (--ply - только ходы на этом полуходе от корня), поздние отсечения
+(ход отсечения был не первым, узлы на ходы до него потрачены зря) и пересчёты ходов, которые
+нулевое окно или сокращённый поиск не смогли отбросить.
+*/
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../Models/Search_trace.h"
+
+using namespace std;
+
+namespace
+{
+struct Trace
+{
+    int board_size = 8;
+    vector<Trace_record> records;
+    // родитель записи (-1 у записей корня) и поиск корня, к которому она относится
+    vector<int> parent;
+    vector<int> root;
+    // записанные ходы узла после записи, по номеру в списке ходов
+    vector<vector<int>> children;
+};
+
+bool load(const string &path, Trace &trace)
+{
+    ifstream fin(path, ios::binary);
+    Trace_header header;
+    if (!fin.read(reinterpret_cast<char *>(&header), sizeof(header)) || string(header.magic, 4) != "CKTR" ||
+        header.record_size != sizeof(Trace_record))
+        return false;
+    trace.board_size = header.board_size;
+    Trace_record record;
+    while (fin.read(reinterpret_cast<char *>(&record), sizeof(record)))
+    {
+        // нулевой хвост файла, который не удалось обрезать
+        if (!record.nodes && !record.hash)
+            break;
+        trace.records.push_back(record);
+    }
+    // Потомки записаны раньше родителя: идём с конца, последняя встреченная запись на полуход
+    // ближе к корню - родитель
+    const int n = int(trace.records.size());
+    trace.parent.assign(n, -1);
+    trace.root.assign(n, -1);
+    trace.children.assign(n, {});
+    vector<int> last_at_ply(256, -1);
+    for (int k = n - 1; k >= 0; --k)
+    {
+        const int ply = trace.records[k].ply;
+        if (ply > 0)
+        {
+            trace.parent[k] = last_at_ply[ply - 1];
+            if (trace.parent[k] >= 0)
+            {
+                trace.root[k] = trace.root[trace.parent[k]];
+                trace.children[trace.parent[k]].push_back(k);
+            }
+        }
+        else
+            trace.root[k] = k;
+        last_at_ply[ply] = k;
+    }
+    for (auto &list : trace.children)
+        sort(list.begin(), list.end(),
+             [&](const int a, const int b) { return trace.records[a].index < trace.records[b].index; });
+    return true;
+}
+
+// Номер поля тёмной клетки (как в Models/Fen.h для 8x8)
+int square_number(const int cell, const int board_size)
+{
+    return cell / board_size * (board_size / 2) + cell % board_size / 2 + 1;
+}
+
+string move_to_text(const Trace_record &record, const int board_size)
+{
+    return to_string(square_number(record.from, board_size)) + (record.jumps ? "x" : "-") +
+           to_string(square_number(record.to, board_size));
+}
+
+// Ходы от корня до записи k
+string path_to_text(const Trace &trace, int k)
+{
+    vector<string> moves;
+    for (; k >= 0 && trace.records[k].ply > 0; k = trace.parent[k])
+        moves.push_back(move_to_text(trace.records[k], trace.board_size));
+    string res;
+    for (auto it = moves.rbegin(); it != moves.rend(); ++it)
+        res += (res.empty() ? "" : " ") + *it;
+    return res;
+}
+
+string flags_to_text(const uint8_t flags)
+{
+    string res;
+    const pair<uint8_t, const char *> names[] = {{TRACE_BEST, "best"},       {TRACE_CUTOFF, "cut"},
+                                                 {TRACE_REDUCED, "lmr"},     {TRACE_LMR_FAIL, "lmr-fail"},
+                                                 {TRACE_RESEARCH, "re-search"}, {TRACE_EXTENDED, "ext"}};
+    for (const auto &name : names)
+        if (flags & name.first)
+            res += (res.empty() ? "" : ",") + string(name.second);
+    return res.empty() ? "-" : res;
+}
+
+// Доля узлов записи k в её поиске корня
+double root_share(const Trace &trace, const int k)
+{
+    const int r = trace.root[k];
+    if (r < 0 || !trace.records[r].nodes)
+        return 0;
+    return 100.0 * trace.records[k].nodes / trace.records[r].nodes;
+}
+
+void print_record(const Trace &trace, const int k, const uint64_t extra = 0, const char *extra_name = nullptr)
+{
+    const auto &r = trace.records[k];
+    printf("  %10" PRIu32 " nodes %5.1f%%  ply %d  depth %d  window [%d, %d]  score %d  moves %d  cutoff %s  %s",
+           r.nodes, root_share(trace, k), r.ply, r.remaining, r.alpha, r.beta, r.score, r.moves,
+           r.cutoff == NO_CUTOFF ? "-" : to_string(r.cutoff).c_str(), flags_to_text(r.flags).c_str());
+    if (extra_name)
+        printf("  %s %" PRIu64, extra_name, extra);
+    printf("\n      %s  (hash %016" PRIx64 ")%s\n", path_to_text(trace, k).c_str(), r.hash,
+           trace.root[k] < 0 ? "  unfinished search" : "");
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        cerr << "usage: trace_analyze <trace file> [--top N] [--ply P]" << endl;
+        return 1;
+    }
+    size_t top = 10;
+    int only_ply = -1;
+    for (int k = 2; k + 1 < argc; k += 2)
+    {
+        const string arg = argv[k], value = argv[k + 1];
+        if (arg == "--top")
+            top = size_t(max(1, stoi(value)));
+        else if (arg == "--ply")
+            only_ply = stoi(value);
+    }
+    Trace trace;
+    if (!load(argv[1], trace))
+    {
+        cerr << "cannot read trace " << argv[1] << endl;
+        return 1;
+    }
+    const auto &records = trace.records;
+    const int n = int(records.size());
+    printf("%d records, board %dx%d\n", n, trace.board_size, trace.board_size);
+
+    // Поиски корня: оценка вне окна - неудача окна стремления, поиск повторён
+    printf("\nroot searches:\n");
+    for (int k = 0; k < n; ++k)
+    {
+        const auto &r = records[k];
+        if (r.ply)
+            continue;
+        const bool failed = r.score <= r.alpha || r.score >= r.beta;
+        printf("  depth %2d  window [%6d, %6d]  score %6d  nodes %10" PRIu32 "  moves %d%s\n", r.remaining + 1,
+               r.alpha, r.beta, r.score, r.nodes, r.moves, failed ? "  (aspiration fail)" : "");
+    }
+
+    // Сводка по полуходам
+    printf("\nper ply: records, nodes, cut nodes, first-move cutoffs, mean cutoff move, re-searches, lmr fails\n");
+    int max_ply = 0;
+    for (const auto &r : records)
+        max_ply = max(max_ply, int(r.ply));
+    for (int ply = 1; ply <= max_ply; ++ply)
+    {
+        uint64_t count = 0, nodes = 0, cut = 0, first = 0, cut_index = 0, research = 0, lmr_fail = 0;
+        for (const auto &r : records)
+        {
+            if (r.ply != ply)
+                continue;
+            ++count;
+            nodes += r.nodes;
+            if (r.cutoff != NO_CUTOFF)
+            {
+                ++cut;
+                first += (r.cutoff == 0);
+                cut_index += r.cutoff;
+            }
+            research += (r.flags & TRACE_RESEARCH) != 0;
+            lmr_fail += (r.flags & TRACE_LMR_FAIL) != 0;
+        }
+        printf("  ply %2d  %8" PRIu64 "  %12" PRIu64 "  %8" PRIu64 "  %5.1f%%  %5.2f  %6" PRIu64 "  %6" PRIu64 "\n", ply,
+               count, nodes, cut, cut ? 100.0 * first / cut : 0.0, cut ? double(cut_index) / cut : 0.0, research,
+               lmr_fail);
+    }
+
+    // Самые дорогие поддеревья
+    vector<int> order;
+    for (int k = 0; k < n; ++k)
+        if (records[k].ply > 0 && (only_ply < 0 || records[k].ply == only_ply))
+            order.push_back(k);
+    sort(order.begin(), order.end(), [&](const int a, const int b) { return records[a].nodes > records[b].nodes; });
+    printf("\nmost expensive subtrees:\n");
+    for (size_t k = 0; k < min(top, order.size()); ++k)
+        print_record(trace, order[k]);
+
+    // Поздние отсечения: узлы на ходы до хода отсечения (если эти ходы записаны)
+    vector<pair<uint64_t, int>> late;
+    for (int k = 0; k < n; ++k)
+    {
+        const auto &r = records[k];
+        if (r.cutoff == NO_CUTOFF || r.cutoff == 0)
+            continue;
+        uint64_t wasted = 0;
+        for (const int child : trace.children[k])
+            if (records[child].index < r.cutoff)
+                wasted += records[child].nodes;
+        late.emplace_back(wasted ? wasted : r.nodes, k);
+    }
+    sort(late.begin(), late.end(), greater<pair<uint64_t, int>>());
+    printf("\nlate cutoffs (cutoff move is not the first one; wasted - nodes of the moves before it):\n");
+    for (size_t k = 0; k < min(top, late.size()); ++k)
+    {
+        // ходы узла глубже TraceDepth не записаны, потерянные узлы неизвестны
+        const bool known = !trace.children[late[k].second].empty();
+        print_record(trace, late[k].second, late[k].first, known ? "wasted" : nullptr);
+    }
+
+    // Пересчёты: нулевое окно или сокращённый поиск не отбросили ход
+    vector<int> research;
+    for (int k = 0; k < n; ++k)
+        if (records[k].flags & (TRACE_RESEARCH | TRACE_LMR_FAIL))
+            research.push_back(k);
+    sort(research.begin(), research.end(),
+         [&](const int a, const int b) { return records[a].nodes > records[b].nodes; });
+    printf("\nre-searched moves (null window or reduction failed to refute the move):\n");
+    for (size_t k = 0; k < min(top, research.size()); ++k)
+        print_record(trace, research[k]);
+    return 0;
+}
@@ -0,0 +1,339 @@
+/*
+Обучение оценки "Network" (Game/Nnue.h) по партиям самоигры.
+Сначала боты играют партии без окна из позиций файла дебютов (партии распределяются по потокам),
+позиции каждой партии помечаются её результатом. Затем сеть учится предсказывать результат:
+sigmoid(оценка / scale) приближается к 1 - победа белых, 0.5 - ничья, 0 - победа черных.
+Позиции с обязательным взятием пропускаются: их статическая оценка не имеет смысла.
+Каждая позиция добавляется ещё и отражённой (доска повёрнута, цвета переставлены).
+Обучение начинается с весов по умолчанию (оценка NumberAndPotential) или с файла --init.
+
+Сборка (Linux):
+    g++ -O2 -std=c++17 -pthread $(sdl2-config --cflags) Tools/train_eval.cpp -o train_eval
+Запуск из корня проекта (нужен settings.json):
+    ./train_eval [--games 2000] [--level 3] [--openings Benchmarks/positions.fen] [--threads N]
+                 [--records games.txt] [--epochs 20] [--lr 1] [--scale 300] [--init eval.nnue] [--out eval.nnue]
+--records - файл партий: новые партии дописываются в него, а уже записанные тоже идут в обучение
+(с --games 0 сеть учится только на файле). Для игры обученной сетью в settings.json указываются
+"BotScoringType": "Network" и "NetworkFile": "eval.nnue".
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Game/Match.h"
+
+using namespace std;
+
+namespace
+{
+// Включённые признаки позиции и результат партии для белых
+struct Sample
+{
+    vector<int> features;
+    float result;
+    // позиция для проверки квантованных весов
+    vector<vector<POS_T>> mtx;
+};
+
+// Сеть с весами float, повторяет Nnue: оценка = psqt + sum(clamp(h, 0, 1) * out) + out_bias
+struct Float_net
+{
+    static const int P = nnue::FEATURES * nnue::HIDDEN + nnue::HIDDEN + nnue::FEATURES + nnue::HIDDEN + 1;
+    // все параметры подряд: hidden, hidden_bias, psqt, out, out_bias
+    vector<float> w = vector<float>(P, 0.f);
+
+    float *hidden(const int f)
+    {
+        return &w[f * nnue::HIDDEN];
+    }
+    float *hidden_bias()
+    {
+        return &w[nnue::FEATURES * nnue::HIDDEN];
+    }
+    float *psqt()
+    {
+        return hidden_bias() + nnue::HIDDEN;
+    }
+    float *out()
+    {
+        return psqt() + nnue::FEATURES;
+    }
+    float &out_bias()
+    {
+        return w[P - 1];
+    }
+
+    // Прямой проход: h - значения скрытого слоя до ограничения
+    float forward(const vector<int> &features, float *h)
+    {
+        float res = out_bias();
+        for (int i = 0; i < nnue::HIDDEN; ++i)
+            h[i] = hidden_bias()[i];
+        for (const int f : features)
+        {
+            res += psqt()[f];
+            const float *row = hidden(f);
+            for (int i = 0; i < nnue::HIDDEN; ++i)
+                h[i] += row[i];
+        }
+        for (int i = 0; i < nnue::HIDDEN; ++i)
+            res += min(max(h[i], 0.f), 1.f) * out()[i];
+        return res;
+    }
+
+    void from_quantized(const Nnue_weights &q)
+    {
+        for (int f = 0; f < nnue::FEATURES; ++f)
+        {
+            for (int i = 0; i < nnue::HIDDEN; ++i)
+                hidden(f)[i] = float(q.hidden[f][i]) / nnue::QA;
+            psqt()[f] = float(q.psqt[f]);
+        }
+        for (int i = 0; i < nnue::HIDDEN; ++i)
+        {
+            hidden_bias()[i] = float(q.hidden_bias[i]) / nnue::QA;
+            out()[i] = float(q.out[i]) / nnue::QB;
+        }
+        out_bias() = float(q.out_bias);
+    }
+
+    void to_quantized(Nnue_weights &q)
+    {
+        auto to_i16 = [](const float v) { return int16_t(max(-32767.f, min(32767.f, round(v)))); };
+        for (int f = 0; f < nnue::FEATURES; ++f)
+        {
+            for (int i = 0; i < nnue::HIDDEN; ++i)
+                q.hidden[f][i] = to_i16(hidden(f)[i] * nnue::QA);
+            q.psqt[f] = int32_t(round(psqt()[f]));
+        }
+        for (int i = 0; i < nnue::HIDDEN; ++i)
+        {
+            q.hidden_bias[i] = to_i16(hidden_bias()[i] * nnue::QA);
+            q.out[i] = to_i16(out()[i] * nnue::QB);
+        }
+        q.out_bias = int32_t(round(out_bias()));
+    }
+};
+
+// Признаки позиции для Nnue
+vector<int> features_of(const vector<vector<POS_T>> &mtx)
+{
+    vector<int> res;
+    for (POS_T x = 0; x < 8; ++x)
+        for (POS_T y = 0; y < 8; ++y)
+            if (mtx[x][y])
+                res.push_back(nnue::feature(mtx[x][y], x, y));
+    return res;
+}
+
+// Доска, повёрнутая на 180 градусов, с переставленными цветами
+vector<vector<POS_T>> mirror(const vector<vector<POS_T>> &mtx)
+{
+    vector<vector<POS_T>> res(8, vector<POS_T>(8, 0));
+    for (POS_T x = 0; x < 8; ++x)
+        for (POS_T y = 0; y < 8; ++y)
+            if (mtx[x][y])
+                res[7 - x][7 - y] = POS_T(mtx[x][y] % 2 ? mtx[x][y] + 1 : mtx[x][y] - 1);
+    return res;
+}
+
+float sigmoid(const float x)
+{
+    return 1.f / (1.f + exp(-x));
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    string openings_path = "Benchmarks/positions.fen", records_path, init_path, out_path = "eval.nnue";
+    int games = 2000, level = 3, epochs = 20;
+    float lr = 1.f, scale = 300.f;
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    for (int k = 1; k + 1 < argc; k += 2)
+    {
+        const string arg = argv[k], value = argv[k + 1];
+        if (arg == "--games")
+            games = stoi(value);
+        else if (arg == "--level")
+            level = stoi(value);
+        else if (arg == "--openings")
+            openings_path = value;
+        else if (arg == "--threads")
+            threads = max(1, stoi(value));
+        else if (arg == "--records")
+            records_path = value;
+        else if (arg == "--epochs")
+            epochs = stoi(value);
+        else if (arg == "--lr")
+            lr = stof(value);
+        else if (arg == "--scale")
+            scale = stof(value);
+        else if (arg == "--init")
+            init_path = value;
+        else if (arg == "--out")
+            out_path = value;
+        else
+        {
+            cerr << "unknown option " << arg << endl;
+            return 1;
+        }
+    }
+
+    // Партии, записанные раньше
+    vector<position_record> records;
+    if (!records_path.empty() && ifstream(records_path))
+        records = load_game_records(records_path);
+    cerr << records.size() << " positions loaded" << endl;
+
+    // Самоигра
+    if (games > 0)
+    {
+        const auto openings = load_fen_file(openings_path);
+        Config config;
+        ofstream records_out;
+        if (!records_path.empty())
+            records_out.open(records_path, ios::app);
+        play_self_play(&config, level, openings, games, threads, [&](const int k, const match_game &game) {
+            for (const auto &pos : game.positions)
+                records.push_back({pos, white_result(game)});
+            if (records_out)
+                write_game_record(records_out, game);
+            if ((k + 1) % 100 == 0)
+                cerr << k + 1 << " games played" << endl;
+        });
+    }
+
+    // Выборка: только спокойные позиции, каждая в двух вариантах
+    Config config;
+    Logic logic(nullptr, &config);
+    vector<Sample> samples;
+    for (const auto &record : records)
+    {
+        const auto mtx = to_mtx(record.pos);
+        logic.find_turns(record.pos.color, mtx);
+        if (logic.have_beats || logic.turns.empty())
+            continue;
+        const auto mirrored = mirror(mtx);
+        samples.push_back({features_of(mtx), float(record.result), mtx});
+        samples.push_back({features_of(mirrored), 1.f - float(record.result), mirrored});
+    }
+    if (samples.empty())
+    {
+        cerr << "no positions to train on" << endl;
+        return 1;
+    }
+    mt19937 rng(0);
+    shuffle(samples.begin(), samples.end(), rng);
+    // 10% позиций - проверочная выборка
+    const size_t valid_size = samples.size() / 10;
+    const vector<Sample> valid(samples.begin(), samples.begin() + valid_size);
+    samples.erase(samples.begin(), samples.begin() + valid_size);
+    cerr << samples.size() << " training and " << valid.size() << " validation samples" << endl;
+
+    Nnue_weights start;
+    if (!init_path.empty())
+        start.load(init_path);
+    Float_net net;
+    net.from_quantized(start);
+    // Скрытый слой начинается со случайных весов первого слоя и нулевого выхода,
+    // поэтому начальная оценка совпадает с исходной
+    if (init_path.empty())
+    {
+        normal_distribution<float> noise(0.f, 0.1f);
+        for (int f = 0; f < nnue::FEATURES; ++f)
+            for (int i = 0; i < nnue::HIDDEN; ++i)
+                net.hidden(f)[i] = noise(rng);
+        for (int i = 0; i < nnue::HIDDEN; ++i)
+            net.hidden_bias()[i] = 0.5f;
+    }
+
+    float h[nnue::HIDDEN];
+    auto loss_of = [&](const vector<Sample> &set) {
+        double sum = 0;
+        for (const auto &s : set)
+        {
+            const float d = sigmoid(net.forward(s.features, h) / scale) - s.result;
+            sum += d * d;
+        }
+        return sum / set.size();
+    };
+    fprintf(stderr, "epoch 0: validation loss %.5f\n", loss_of(valid));
+
+    // Adam. Шаг задаётся в единицах параметра: сотые доли шашки для psqt и выхода,
+    // доли активации для первого слоя
+    vector<float> step(Float_net::P, 1e-3f * lr), m(Float_net::P, 0.f), v(Float_net::P, 0.f), grad(Float_net::P);
+    for (int p = nnue::FEATURES * nnue::HIDDEN + nnue::HIDDEN; p < Float_net::P; ++p)
+        step[p] = 0.5f * lr;
+    const float beta1 = 0.9f, beta2 = 0.999f;
+    const size_t batch = 256;
+    int t = 0;
+    for (int epoch = 1; epoch <= epochs; ++epoch)
+    {
+        shuffle(samples.begin(), samples.end(), rng);
+        for (size_t begin = 0; begin < samples.size(); begin += batch)
+        {
+            fill(grad.begin(), grad.end(), 0.f);
+            const size_t end = min(samples.size(), begin + batch);
+            for (size_t k = begin; k < end; ++k)
+            {
+                const auto &s = samples[k];
+                const float p = sigmoid(net.forward(s.features, h) / scale);
+                // производная (p - result)^2 по оценке
+                const float g = 2 * (p - s.result) * p * (1 - p) / scale;
+                grad[Float_net::P - 1] += g;
+                float *out_grad = &grad[net.out() - net.w.data()];
+                float hidden_grad[nnue::HIDDEN];
+                for (int i = 0; i < nnue::HIDDEN; ++i)
+                {
+                    out_grad[i] += g * min(max(h[i], 0.f), 1.f);
+                    hidden_grad[i] = (h[i] > 0 && h[i] < 1) ? g * net.out()[i] : 0.f;
+                }
+                float *bias_grad = &grad[net.hidden_bias() - net.w.data()];
+                for (int i = 0; i < nnue::HIDDEN; ++i)
+                    bias_grad[i] += hidden_grad[i];
+                for (const int f : s.features)
+                {
+                    grad[net.psqt() - net.w.data() + f] += g;
+                    float *row = &grad[f * nnue::HIDDEN];
+                    for (int i = 0; i < nnue::HIDDEN; ++i)
+                        row[i] += hidden_grad[i];
+                }
+            }
+            ++t;
+            const float c1 = 1 - pow(beta1, t), c2 = 1 - pow(beta2, t);
+            for (int p = 0; p < Float_net::P; ++p)
+            {
+                const float gp = grad[p] / (end - begin);
+                m[p] = beta1 * m[p] + (1 - beta1) * gp;
+                v[p] = beta2 * v[p] + (1 - beta2) * gp * gp;
+                net.w[p] -= step[p] * (m[p] / c1) / (sqrt(v[p] / c2) + 1e-8f);
+            }
+            // Веса первого слоя ограничены, чтобы аккумулятор int16 не переполнялся
+            for (int p = 0; p < nnue::FEATURES * nnue::HIDDEN + nnue::HIDDEN; ++p)
+                net.w[p] = max(-4.f, min(4.f, net.w[p]));
+        }
+        fprintf(stderr, "epoch %d: training loss %.5f, validation loss %.5f\n", epoch, loss_of(samples),
+                loss_of(valid));
+    }
+
+    Nnue_weights trained;
+    net.to_quantized(trained);
+    // Проверка квантованных весов той же выборкой, но через Nnue
+    const Nnue quantized(make_shared<Nnue_weights>(trained));
+    double sum = 0;
+    for (const auto &s : valid)
+    {
+        const float d = sigmoid(quantized.evaluate(quantized.accumulator(s.mtx)) / scale) - s.result;
+        sum += d * d;
+    }
+    fprintf(stderr, "quantized validation loss %.5f\n", sum / valid.size());
+    trained.save(out_path);
+    cerr << "weights written to " << out_path << endl;
+    return 0;
+}
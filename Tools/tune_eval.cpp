@@ -0,0 +1,315 @@
+/*
+Подбор параметров оценки Logic::calc_score (Models/Eval_params.h) по партиям самоигры.
+Два метода:
+    texel - по позициям сыгранных партий: ищутся параметры, при которых sigmoid(оценка / scale)
+            лучше всего предсказывает результат партии (покоординатный спуск, scale подбирается заранее).
+            Партии играются параллельно во всех потоках, ошибка тоже считается параллельно
+            пакетной оценкой (Game/Batch_eval.h; с -mavx2 - по 8 позиций за команду);
+    spsa  - по матчам: на каждом шаге все параметры одновременно сдвигаются на +-c в случайных
+            направлениях, боты с параметрами theta+ и theta- играют мини-матч,
+            и параметры сдвигаются в сторону победителя.
+Результат записывается в JSON-файл, который Logic читает при создании (EvalParamsFile в settings.json).
+
+Сборка (Linux):
+    g++ -O2 -std=c++17 -pthread $(sdl2-config --cflags) Tools/tune_eval.cpp -o tune_eval
+Запуск из корня проекта (нужен settings.json):
+    ./tune_eval [--method texel|spsa] [--games 2000] [--level 3] [--openings Benchmarks/positions.fen]
+                [--records games.txt] [--iterations 200] [--threads N] [--out eval_params.json]
+texel: --games - число партий самоигры (дописываются в --records, если он задан).
+spsa: --iterations - число шагов, --games - число партий в мини-матче каждого шага.
+Начальные параметры берутся из EvalParamsFile.
+*/
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../Game/Match.h"
+
+using namespace std;
+
+namespace
+{
+// Подбираемые параметры как массив, для перебора по координатам
+const int PARAMS = 3;
+const char *param_names[PARAMS] = {"King", "NumberOnlyKing", "Row"};
+
+int &param(Eval_params &params, const int k)
+{
+    return k == 0 ? params.king : (k == 1 ? params.number_only_king : params.row);
+}
+
+int param(const Eval_params &params, const int k)
+{
+    return param(const_cast<Eval_params &>(params), k);
+}
+
+// Позиции для texel пакетом (Game/Batch_eval.h, оценка с точки зрения белых) и результаты партий для белых.
+// Позиции разложены по потокам: каждый поток оценивает свой пакет целиком
+struct Samples
+{
+    Position_batch batch;
+    vector<double> result;
+};
+
+double sigmoid(const double x)
+{
+    return 1 / (1 + exp(-x));
+}
+
+// Средняя квадратичная ошибка предсказания результата, каждый пакет parts считается в своём потоке.
+// Складываются ошибки оценок NumberAndPotential и NumberOnly: параметры у них разные
+double texel_loss(const vector<Samples> &parts, const Eval_params &params, const double scale, Config *config)
+{
+    const size_t threads = parts.size();
+    vector<double> sums(threads, 0);
+    vector<thread> pool;
+    for (size_t t = 0; t < threads; ++t)
+    {
+        pool.emplace_back([&, t] {
+            // Режим оценки запоминается при создании Logic
+            Config local = *config;
+            local.set("Bot", "BotScoringType", "NumberAndPotential");
+            Logic potential(nullptr, &local);
+            local.set("Bot", "BotScoringType", "NumberOnly");
+            Logic number_only(nullptr, &local);
+            potential.params = number_only.params = params;
+            vector<int> scores;
+            for (const Logic *logic : {&potential, &number_only})
+            {
+                logic->calc_scores(parts[t].batch, scores);
+                for (size_t k = 0; k < scores.size(); ++k)
+                {
+                    const double d = sigmoid(scores[k] / scale) - parts[t].result[k];
+                    sums[t] += d * d;
+                }
+            }
+        });
+    }
+    for (auto &th : pool)
+        th.join();
+    double sum = 0;
+    size_t count = 0;
+    for (size_t t = 0; t < threads; ++t)
+    {
+        sum += sums[t];
+        count += parts[t].result.size();
+    }
+    return sum / count;
+}
+
+void print_params(const char *prefix, const Eval_params &params)
+{
+    fprintf(stderr, "%s", prefix);
+    for (int k = 0; k < PARAMS; ++k)
+        fprintf(stderr, " %s %d", param_names[k], param(params, k));
+    fprintf(stderr, "\n");
+}
+
+Eval_params tune_texel(Config *config, const vector<position_record> &records, Eval_params params,
+                       const unsigned threads)
+{
+    // Только спокойные позиции: у ходящего нет обязательного взятия
+    Logic logic(nullptr, config);
+    vector<Samples> samples(threads);
+    size_t count = 0;
+    for (const auto &record : records)
+    {
+        const auto mtx = to_mtx(record.pos);
+        logic.find_turns(record.pos.color, mtx);
+        if (!logic.have_beats && !logic.turns.empty())
+        {
+            auto &part = samples[count++ % threads];
+            part.batch.add(record.pos, 0);
+            part.result.push_back(record.result);
+        }
+    }
+    cerr << count << " quiet positions" << endl;
+    if (!count)
+        return params;
+
+    // scale, при котором текущие параметры лучше всего предсказывают результат (золотое сечение)
+    double lo = 20, hi = 2000;
+    const double phi = (sqrt(5.0) - 1) / 2;
+    for (int k = 0; k < 30; ++k)
+    {
+        const double a = hi - (hi - lo) * phi, b = lo + (hi - lo) * phi;
+        if (texel_loss(samples, params, a, config) < texel_loss(samples, params, b, config))
+            hi = b;
+        else
+            lo = a;
+    }
+    const double scale = (lo + hi) / 2;
+    double best = texel_loss(samples, params, scale, config);
+    fprintf(stderr, "scale %.1f, loss %.6f\n", scale, best);
+
+    // Покоординатный спуск с уменьшающимся шагом
+    for (int step = 64; step >= 1;)
+    {
+        bool improved = false;
+        for (int k = 0; k < PARAMS; ++k)
+        {
+            for (const int dir : {1, -1})
+            {
+                Eval_params next = params;
+                param(next, k) += dir * step;
+                if (param(next, k) < 0)
+                    continue;
+                const double loss = texel_loss(samples, next, scale, config);
+                if (loss < best)
+                {
+                    best = loss;
+                    params = next;
+                    improved = true;
+                    break;
+                }
+            }
+        }
+        fprintf(stderr, "step %d, loss %.6f:", step, best);
+        print_params("", params);
+        if (!improved)
+            step /= 2;
+    }
+    return params;
+}
+
+Eval_params tune_spsa(Config *config, const vector<fen_position> &openings, Eval_params params, const int level,
+                      const int iterations, const int games, const unsigned threads)
+{
+    mt19937 rng(0);
+    // Параметры подбираются в вещественных числах, в ботов идут округлённые
+    double theta[PARAMS];
+    for (int k = 0; k < PARAMS; ++k)
+        theta[k] = param(params, k);
+    // Размер пробного сдвига и шага для каждого параметра
+    const double c[PARAMS] = {40, 40, 3}, a[PARAMS] = {200, 200, 15};
+    const int max_turns = config->settings()->max_num_turns;
+    for (int it = 0; it < iterations; ++it)
+    {
+        // Убывающие шаги SPSA
+        const double ck = 1 / pow(it + 1, 0.101), ak = 1 / pow(it + 1 + iterations / 10.0, 0.602);
+        int delta[PARAMS];
+        Eval_params plus, minus;
+        for (int k = 0; k < PARAMS; ++k)
+        {
+            delta[k] = (rng() % 2) ? 1 : -1;
+            param(plus, k) = max(0, int(round(theta[k] + c[k] * ck * delta[k])));
+            param(minus, k) = max(0, int(round(theta[k] - c[k] * ck * delta[k])));
+        }
+        // Мини-матч theta+ против theta-: каждый дебют дважды со сменой цветов
+        const size_t first = rng() % openings.size();
+        atomic<int> next_game{0};
+        atomic<int> points{0}; // очки theta+ в полуочках
+        auto worker = [&] {
+            Logic bot_plus(nullptr, config), bot_minus(nullptr, config);
+            bot_plus.params = plus;
+            bot_minus.params = minus;
+            const int levels[2] = {level, level};
+            int k;
+            while ((k = next_game++) < games)
+            {
+                const bool plus_black = k % 2;
+                Logic *bots[2] = {plus_black ? &bot_minus : &bot_plus, plus_black ? &bot_plus : &bot_minus};
+                const auto game = play_match_game(bots, levels, openings[(first + k / 2) % openings.size()], max_turns);
+                points += (game.result == 0) ? 1 : (((game.result == 2) == plus_black) ? 2 : 0);
+            }
+        };
+        vector<thread> pool;
+        for (unsigned t = 0; t < threads; ++t)
+            pool.emplace_back(worker);
+        for (auto &th : pool)
+            th.join();
+        // Доля очков theta+ минус доля очков theta-, от -1 до 1
+        const double diff = (points - games) / double(games);
+        for (int k = 0; k < PARAMS; ++k)
+            theta[k] = max(0.0, theta[k] + a[k] * ak * diff * delta[k]);
+        for (int k = 0; k < PARAMS; ++k)
+            param(params, k) = int(round(theta[k]));
+        fprintf(stderr, "iteration %d, theta+ scored %+.2f:", it + 1, diff);
+        print_params("", params);
+    }
+    return params;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    string method = "texel", openings_path = "Benchmarks/positions.fen", records_path, out_path = "eval_params.json";
+    int games = -1, level = 3, iterations = 200;
+    unsigned threads = max(1u, thread::hardware_concurrency());
+    for (int k = 1; k + 1 < argc; k += 2)
+    {
+        const string arg = argv[k], value = argv[k + 1];
+        if (arg == "--method")
+            method = value;
+        else if (arg == "--games")
+            games = stoi(value);
+        else if (arg == "--level")
+            level = stoi(value);
+        else if (arg == "--openings")
+            openings_path = value;
+        else if (arg == "--records")
+            records_path = value;
+        else if (arg == "--iterations")
+            iterations = stoi(value);
+        else if (arg == "--threads")
+            threads = max(1, stoi(value));
+        else if (arg == "--out")
+            out_path = value;
+        else
+        {
+            cerr << "unknown option " << arg << endl;
+            return 1;
+        }
+    }
+    if (method != "texel" && method != "spsa")
+    {
+        cerr << "unknown method " << method << endl;
+        return 1;
+    }
+
+    Config config;
+    const auto openings = load_fen_file(openings_path);
+    // Начальные параметры - текущие из EvalParamsFile
+    Eval_params params = Logic(nullptr, &config).params;
+    print_params("start:", params);
+
+    if (method == "texel")
+    {
+        vector<position_record> records;
+        if (!records_path.empty() && ifstream(records_path))
+            records = load_game_records(records_path);
+        cerr << records.size() << " positions loaded" << endl;
+        if (games < 0)
+            games = 2000;
+        ofstream records_out;
+        if (!records_path.empty())
+            records_out.open(records_path, ios::app);
+        play_self_play(&config, level, openings, games, threads, [&](const int k, const match_game &game) {
+            for (const auto &pos : game.positions)
+                records.push_back({pos, white_result(game)});
+            if (records_out)
+                write_game_record(records_out, game);
+            if ((k + 1) % 100 == 0)
+                cerr << k + 1 << " games played" << endl;
+        });
+        params = tune_texel(&config, records, params, threads);
+    }
+    else
+    {
+        if (games < 0)
+            games = 64;
+        params = tune_spsa(&config, openings, params, level, iterations, max(2, games), threads);
+    }
+
+    params.save(out_path);
+    print_params("result:", params);
+    cerr << "written to " << out_path << endl;
+    return 0;
+}